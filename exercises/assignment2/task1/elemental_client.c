@@ -0,0 +1,45 @@
+/*
+ * Runs elementals through elemental_server and prints what they printed and their exit status.
+ *
+ *   ./elemental_client [-s socket_path] fire|water|earth|air ...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fork_server.h"
+
+int main(int argc, char **argv) {
+    const char *path = FS_DEFAULT_PATH;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-s") == 0) {
+        path = argv[2];
+        first = 3;
+    }
+    if (first >= argc) {
+        fprintf(stderr, "Usage: %s [-s socket_path] fire|water|earth|air ...\n", argv[0]);
+        return 1;
+    }
+
+    int fd = fs_connect(path);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+
+    int failed = 0;
+    for (int i = first; i < argc; i++) {
+        char *out;
+        uint32_t len;
+        int status = fs_run(fd, argv[i], &out, &len);
+        if (status < 0) {
+            fprintf(stderr, "Connection to %s lost\n", path);
+            return 1;
+        }
+        fwrite(out, 1, len, stdout);
+        printf("%s exited with status %d\n", argv[i], status);
+        free(out);
+        failed |= status != 0;
+    }
+    close(fd);
+    return failed;
+}
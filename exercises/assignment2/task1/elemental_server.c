@@ -0,0 +1,165 @@
+/*
+ * Fork server ("zygote") for the elemental programs. Running ./fire_elemental the normal way
+ * costs a fork, an exec, and the dynamic linking and C library startup of a new program. This
+ * server has all four elementals linked in (built with -DELEMENTAL_NO_MAIN) and is started once.
+ * For each request it forks a copy of itself, already loaded and initialized, which just calls
+ * the entry point.
+ *
+ *   ./elemental_server [socket_path]    (default /tmp/elemental.sock; protocol in fork_server.h)
+ *
+ * Every connection gets its own handler process, so several clients are served at once. For
+ * each request, the handler forks the elemental child with stdout on a pipe, collects its
+ * output, waits for it, and sends back the exit status and the output.
+ */
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "elementals.h"
+#include "fork_server.h"
+
+static const struct {
+    const char *name;
+    int (*main)(void);
+} ELEMENTALS[] = {
+    {"fire", fire_elemental_main},
+    {"water", water_elemental_main},
+    {"earth", earth_elemental_main},
+    {"air", air_elemental_main},
+};
+
+static volatile sig_atomic_t stopping;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stopping = 1;
+}
+
+/* Runs entry in a forked child with its stdout on a pipe; returns its exit status */
+static int run_child(int (*entry)(void), char **out, uint32_t *out_len) {
+    int pipefd[2];
+    if (pipe(pipefd) != 0) return -1;
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(pipefd[0]);
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[1]);
+        exit(entry()); /* exit(), not _exit(): stdout has to be flushed into the pipe */
+    }
+
+    close(pipefd[1]);
+    size_t len = 0, cap = 256;
+    char *buf = malloc(cap), drop[4096];
+    if (!buf) cap = 0;
+    for (;;) {
+        if (len == cap && cap > 0 && cap < FS_MAX_OUTPUT) {
+            char *bigger = realloc(buf, cap * 2);
+            if (bigger) {
+                buf = bigger;
+                cap *= 2;
+            }
+        }
+        /* Once the buffer is full, the rest is read and dropped so the child can finish */
+        int keep = len < cap;
+        ssize_t n = read(pipefd[0], keep ? buf + len : drop, keep ? cap - len : sizeof(drop));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (keep) len += (size_t)n;
+    }
+    close(pipefd[0]);
+
+    int status;
+    pid_t waited;
+    while ((waited = waitpid(pid, &status, 0)) < 0 && errno == EINTR) {
+    }
+    *out = buf;
+    *out_len = (uint32_t)len;
+    if (waited != pid) return -1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/* One client connection, in its own process: requests until the client hangs up */
+static void serve(int conn) {
+    uint8_t len;
+    char name[256];
+    while (fs_read_full(conn, &len, 1) == 0 && fs_read_full(conn, name, len) == 0) {
+        name[len] = '\0';
+
+        int32_t status = 127;
+        char *out = NULL;
+        uint32_t out_len = 0;
+        for (size_t i = 0; i < sizeof(ELEMENTALS) / sizeof(ELEMENTALS[0]); i++) {
+            if (strcmp(name, ELEMENTALS[i].name) == 0) {
+                status = run_child(ELEMENTALS[i].main, &out, &out_len);
+            }
+        }
+
+        int ok = fs_write_full(conn, &status, sizeof(status)) == 0 &&
+                 fs_write_full(conn, &out_len, sizeof(out_len)) == 0 && fs_write_full(conn, out, out_len) == 0;
+        free(out);
+        if (!ok) break;
+    }
+    close(conn);
+}
+
+int main(int argc, char **argv) {
+    const char *path = (argc > 1) ? argv[1] : FS_DEFAULT_PATH;
+
+    struct sockaddr_un addr;
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd < 0 || fs_address(&addr, path) != 0) {
+        perror("socket");
+        return 1;
+    }
+    unlink(path);
+    if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 128) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    /* Handlers are never waited for: let the kernel reap them. SIGINT/SIGTERM stop accept() */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_IGN;
+    sa.sa_flags = SA_NOCLDWAIT;
+    sigaction(SIGCHLD, &sa, NULL);
+    sa.sa_handler = on_signal;
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Elemental server: PID = %d, listening on %s\n", getpid(), path);
+    fflush(stdout); /* nothing unwritten may be inherited by the children */
+
+    while (!stopping) {
+        int conn = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) continue; /* EINTR when stopping */
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(lfd);
+            /* The handler waits for its own children */
+            signal(SIGCHLD, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            serve(conn);
+            _exit(0);
+        }
+        if (pid < 0) perror("fork");
+        close(conn);
+    }
+
+    close(lfd);
+    unlink(path);
+    printf("Elemental server: stopped\n");
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef ELEMENTALS_H
+#define ELEMENTALS_H
+
+/* Entry points of the four elemental programs. Each is its own program with a main(), or, built
+ * with -DELEMENTAL_NO_MAIN, part of elemental_server, which runs them in forked children. */
+int fire_elemental_main(void);
+int water_elemental_main(void);
+int earth_elemental_main(void);
+int air_elemental_main(void);
+
+#endif
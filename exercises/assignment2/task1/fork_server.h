@@ -0,0 +1,100 @@
+#ifndef FORK_SERVER_H
+#define FORK_SERVER_H
+
+/*
+ * Wire protocol of elemental_server, a fork server for the elemental programs, over a Unix
+ * stream socket. A connection carries any number of requests, one after the other:
+ *
+ *   request   u8 name length, name ("fire", "water", "earth" or "air")
+ *   response  i32 exit status (127: unknown name), u32 output length, the child's stdout
+ *
+ * fs_connect() and fs_run() are the client side.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define FS_DEFAULT_PATH "/tmp/elemental.sock"
+#define FS_MAX_OUTPUT (1 << 20) /* larger output is cut off */
+
+static inline int fs_read_full(int fd, void *buf, size_t len) {
+    char *p = (char *)buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static inline int fs_write_full(int fd, const void *buf, size_t len) {
+    const char *p = (const char *)buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static inline int fs_address(struct sockaddr_un *addr, const char *path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+/* Returns a connected socket, or -1 with errno set */
+static inline int fs_connect(const char *path) {
+    struct sockaddr_un addr;
+    if (fs_address(&addr, path) != 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Runs elemental `name` through the server. Returns its exit status and sets *out (malloc'd,
+ * NUL-terminated, caller frees) and *out_len to what it printed; -1 if the connection failed. */
+static inline int fs_run(int fd, const char *name, char **out, uint32_t *out_len) {
+    uint8_t req[256];
+    size_t len = strlen(name);
+    if (len > 255) len = 255;
+    req[0] = (uint8_t)len;
+    memcpy(req + 1, name, len);
+    if (fs_write_full(fd, req, len + 1) != 0) return -1;
+
+    int32_t status;
+    uint32_t n;
+    if (fs_read_full(fd, &status, sizeof(status)) != 0 || fs_read_full(fd, &n, sizeof(n)) != 0 ||
+        n > FS_MAX_OUTPUT) {
+        return -1;
+    }
+    char *buf = (char *)malloc((size_t)n + 1);
+    if (!buf || fs_read_full(fd, buf, n) != 0) {
+        free(buf);
+        return -1;
+    }
+    buf[n] = '\0';
+    *out = buf;
+    *out_len = n;
+    return status;
+}
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef LAUNCH_H
+#define LAUNCH_H
+
+/*
+ * Starting and reaping many child programs.
+ *
+ *   LAUNCH_FORK    fork() then execv(): the original task1 code. fork() copies the parent's page
+ *                  tables (and marks every page copy-on-write), so it gets slower as the
+ *                  parent grows, only for the child to throw it all away in execv()
+ *   LAUNCH_VFORK   clone(CLONE_VM | CLONE_VFORK): the child runs on a small stack of its own in
+ *                  the parent's memory, and the parent is suspended until the child calls
+ *                  execv(). Nothing is copied, so the cost does not depend on the parent's size
+ *   LAUNCH_SPAWN   posix_spawn(): the C library's way to do the same (glibc uses clone(CLONE_VM |
+ *                  CLONE_VFORK) internally), and it reports exec failures to the caller
+ *
+ * Reaping: every child gets a pidfd, which becomes readable when the child exits. The pidfds
+ * sit in one epoll set, so one epoll_wait() collects however many children have finished, and
+ * waitid(P_PIDFD) reaps exactly those. Nothing blocks on a particular child, and no child is left
+ * a zombie.
+ *
+ * launch() with LAUNCH_VFORK reuses one child stack, so call it from one thread at a time.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#ifndef P_PIDFD
+# define P_PIDFD 3
+#endif
+#ifndef SYS_pidfd_open
+# define SYS_pidfd_open 434
+#endif
+
+#define LAUNCH_STACK_SIZE (64 * 1024) /* the vfork child only calls dup2() and execv() */
+
+extern char **environ;
+
+typedef enum { LAUNCH_FORK, LAUNCH_VFORK, LAUNCH_SPAWN } launch_method_t;
+
+static const char *launch_method_name[] = {"fork+exec", "clone(VM|VFORK)", "posix_spawn"};
+
+typedef struct {
+    const char *path;
+    char *const *argv;
+    int out_fd; /* becomes the child's stdout, or -1 to inherit */
+} launch_args_t;
+
+static int launch_vfork_child(void *arg) {
+    const launch_args_t *a = (const launch_args_t *)arg;
+    if (a->out_fd >= 0) dup2(a->out_fd, STDOUT_FILENO);
+    execv(a->path, a->argv);
+    _exit(127); /* exec failed; the parent's memory is shared, so touch nothing else */
+}
+
+/* Start path with argv; out_fd (or -1) becomes its stdout. Returns the pid, or -1 with errno set */
+static inline pid_t launch(launch_method_t method, const char *path, char *const argv[], int out_fd) {
+    if (method == LAUNCH_SPAWN) {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        if (out_fd >= 0) posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+        pid_t pid;
+        int err = posix_spawn(&pid, path, &actions, NULL, argv, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        if (err != 0) {
+            errno = err;
+            return -1;
+        }
+        return pid;
+    }
+
+    if (method == LAUNCH_VFORK) {
+        /* One stack is enough: the parent does not run again until the child has exec'd */
+        static char *stack;
+        if (!stack && !(stack = (char *)malloc(LAUNCH_STACK_SIZE))) return -1;
+        launch_args_t a = {path, argv, out_fd};
+        return clone(launch_vfork_child, stack + LAUNCH_STACK_SIZE, CLONE_VM | CLONE_VFORK | SIGCHLD, &a);
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (out_fd >= 0) dup2(out_fd, STDOUT_FILENO);
+        execv(path, argv);
+        _exit(127);
+    }
+    return pid;
+}
+
+typedef struct {
+    int epfd;
+    int running; /* children added and not reaped yet */
+} launch_reaper_t;
+
+typedef struct {
+    pid_t pid;
+    int status; /* exit code, or 128 + signal number */
+} launch_exit_t;
+
+static inline int launch_reaper_init(launch_reaper_t *r) {
+    r->running = 0;
+    r->epfd = epoll_create1(EPOLL_CLOEXEC);
+    return r->epfd < 0 ? -1 : 0;
+}
+
+static inline void launch_reaper_destroy(launch_reaper_t *r) {
+    close(r->epfd);
+}
+
+/* Watch child pid; it is reaped by a later launch_reaper_wait(). Returns 0, or -1 on error */
+static inline int launch_reaper_add(launch_reaper_t *r, pid_t pid) {
+    /* Works even if the child has already exited: it stays a zombie until waitid() */
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd < 0) return -1;
+    fcntl(pidfd, F_SETFD, FD_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data = {.u64 = ((uint64_t)(uint32_t)pid << 32) | (uint32_t)pidfd}};
+    if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, pidfd, &ev) != 0) {
+        close(pidfd);
+        return -1;
+    }
+    r->running++;
+    return 0;
+}
+
+/* Reap up to max children that have exited, waiting up to timeout_ms (-1: until one does).
+ * Returns how many were reaped into out[], or -1 on error. */
+static inline int launch_reaper_wait(launch_reaper_t *r, launch_exit_t *out, int max, int timeout_ms) {
+    struct epoll_event ev[64];
+    if (max > 64) max = 64;
+    if (r->running == 0) return 0;
+    int n = epoll_wait(r->epfd, ev, max, timeout_ms);
+    if (n < 0) return errno == EINTR ? 0 : -1;
+    for (int i = 0; i < n; i++) {
+        int pidfd = (int)(uint32_t)ev[i].data.u64;
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid((idtype_t)P_PIDFD, (id_t)pidfd, &info, WEXITED) != 0) return -1;
+        out[i].pid = (pid_t)(ev[i].data.u64 >> 32);
+        out[i].status = info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status;
+        /* close() alone would leave it in the set while a fork()ed child that has not reached
+         * execv() yet still holds a copy of the descriptor */
+        epoll_ctl(r->epfd, EPOLL_CTL_DEL, pidfd, NULL);
+        close(pidfd);
+        r->running--;
+    }
+    return n;
+}
+
+#endif
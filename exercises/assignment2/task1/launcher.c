@@ -0,0 +1,113 @@
+/*
+ * Starts many elemental children at once and reaps them as they finish (see launch.h).
+ *
+ *   ./launcher [-m fork|vfork|spawn] [-n children] [-j in_flight] [-q] [fire|water|earth|air|all]
+ *
+ * Defaults: posix_spawn, 1000 children, at most 256 running at a time, all four elementals in
+ * turn. -q sends the children's output to /dev/null.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "launch.h"
+
+static const char *ELEMENTALS[] = {"./fire_elemental", "./water_elemental", "./earth_elemental", "./air_elemental"};
+static const char *NAMES[] = {"fire", "water", "earth", "air"};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    launch_method_t method = LAUNCH_SPAWN;
+    long count = 1000;
+    int in_flight = 256, quiet = 0, only = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-m") == 0) {
+            i++;
+            if (strcmp(argv[i], "fork") == 0) method = LAUNCH_FORK;
+            else if (strcmp(argv[i], "vfork") == 0) method = LAUNCH_VFORK;
+            else if (strcmp(argv[i], "spawn") == 0) method = LAUNCH_SPAWN;
+            else only = -2;
+        } else if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+            count = atol(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-j") == 0) {
+            in_flight = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-q") == 0) {
+            quiet = 1;
+        } else if (strcmp(argv[i], "all") == 0) {
+            only = -1;
+        } else {
+            only = -2;
+            for (int e = 0; e < 4; e++) {
+                if (strcmp(argv[i], NAMES[e]) == 0) only = e;
+            }
+        }
+        if (only == -2) break;
+    }
+    if (only == -2 || count < 1 || in_flight < 1) {
+        fprintf(stderr, "Usage: %s [-m fork|vfork|spawn] [-n children] [-j in_flight] [-q] [fire|water|earth|air|all]\n",
+                argv[0]);
+        return 1;
+    }
+
+    int out_fd = -1;
+    if (quiet && (out_fd = open("/dev/null", O_WRONLY | O_CLOEXEC)) < 0) {
+        perror("/dev/null");
+        return 1;
+    }
+    launch_reaper_t reaper;
+    if (launch_reaper_init(&reaper) != 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    printf("Launcher: PID = %d, %ld children with %s, at most %d at a time\n", getpid(), count,
+           launch_method_name[method], in_flight);
+    fflush(stdout); /* a fork()ed child would otherwise inherit unwritten output */
+
+    long started = 0, reaped = 0, failed = 0;
+    launch_exit_t done[64];
+    double start = now_sec();
+    while (reaped < count) {
+        while (started < count && reaper.running < in_flight) {
+            int e = only >= 0 ? only : (int)(started % 4);
+            char *child_argv[] = {(char *)ELEMENTALS[e], NULL};
+            pid_t pid = launch(method, ELEMENTALS[e], child_argv, out_fd);
+            if (pid < 0) {
+                perror(ELEMENTALS[e]);
+                return 1;
+            }
+            if (launch_reaper_add(&reaper, pid) != 0) {
+                perror("pidfd_open");
+                return 1;
+            }
+            started++;
+        }
+
+        int n = launch_reaper_wait(&reaper, done, 64, -1);
+        if (n < 0) {
+            perror("waitid");
+            return 1;
+        }
+        for (int i = 0; i < n; i++) {
+            if (done[i].status != 0) {
+                fprintf(stderr, "Child %d exited with status %d\n", done[i].pid, done[i].status);
+                failed++;
+            }
+        }
+        reaped += n;
+    }
+    double elapsed = now_sec() - start;
+
+    printf("Launcher: %ld children reaped (%ld failed) in %.3f s, %.0f launches/s\n", reaped, failed, elapsed,
+           (double)reaped / elapsed);
+    launch_reaper_destroy(&reaper);
+    if (out_fd >= 0) close(out_fd);
+    return failed ? 1 : 0;
+}
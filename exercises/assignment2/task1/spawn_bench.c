@@ -0,0 +1,100 @@
+/*
+ * Launches per second for fork+exec, clone(CLONE_VM | CLONE_VFORK) and posix_spawn while the
+ * parent's resident memory grows from a few MB to GBs. Every child is ./air_elemental with its
+ * output sent to /dev/null, and the launches are timed until the child has been reaped.
+ *
+ *   ./spawn_bench [max_mb] [launches]    (default up to 2048 MB, 200 launches per point)
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "launch.h"
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static long rss_mb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    long pages = 0, resident = 0;
+    if (f) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return resident * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+/* Launches per second: one child at a time, each reaped through its pidfd before the next */
+static double measure(launch_method_t method, int launches, int out_fd, launch_reaper_t *reaper) {
+    char *child_argv[] = {"./air_elemental", NULL};
+    launch_exit_t done;
+    double start = now_sec();
+    for (int i = 0; i < launches; i++) {
+        pid_t pid = launch(method, child_argv[0], child_argv, out_fd);
+        if (pid < 0 || launch_reaper_add(reaper, pid) != 0) {
+            perror("launch");
+            exit(1);
+        }
+        while (launch_reaper_wait(reaper, &done, 1, -1) == 0) {
+        }
+        if (done.status != 0) {
+            fprintf(stderr, "child exited with status %d\n", done.status);
+            exit(1);
+        }
+    }
+    return launches / (now_sec() - start);
+}
+
+int main(int argc, char **argv) {
+    long max_mb = (argc > 1) ? atol(argv[1]) : 2048;
+    int launches = (argc > 2) ? atoi(argv[2]) : 200;
+    if (max_mb < 1 || launches < 1) {
+        fprintf(stderr, "Usage: %s [max_mb] [launches]\n", argv[0]);
+        return 1;
+    }
+    if (access("./air_elemental", X_OK) != 0) {
+        fprintf(stderr, "./air_elemental not found: run make first\n");
+        return 1;
+    }
+
+    int out_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    launch_reaper_t reaper;
+    if (out_fd < 0 || launch_reaper_init(&reaper) != 0) {
+        perror("setup");
+        return 1;
+    }
+
+    printf("%10s %16s %16s %16s\n", "RSS (MB)", launch_method_name[LAUNCH_FORK], launch_method_name[LAUNCH_VFORK],
+           launch_method_name[LAUNCH_SPAWN]);
+    char *ballast = NULL;
+    long have = 0;
+    for (long mb = 16;; mb = mb * 4 < max_mb ? mb * 4 : max_mb) {
+        /* Grow the parent: fresh anonymous memory, every page written so it is really resident */
+        long add = mb - have;
+        if (add > 0) {
+            ballast = mmap(NULL, (size_t)add << 20, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (ballast == MAP_FAILED) {
+                perror("mmap");
+                return 1;
+            }
+            memset(ballast, 1, (size_t)add << 20);
+            have = mb;
+        }
+
+        double f = measure(LAUNCH_FORK, launches, out_fd, &reaper);
+        double v = measure(LAUNCH_VFORK, launches, out_fd, &reaper);
+        double s = measure(LAUNCH_SPAWN, launches, out_fd, &reaper);
+        printf("%10ld %12.0f /s  %12.0f /s  %12.0f /s\n", rss_mb(), f, v, s);
+        fflush(stdout);
+        if (mb >= max_mb) break;
+    }
+
+    launch_reaper_destroy(&reaper);
+    close(out_fd);
+    return 0;
+}
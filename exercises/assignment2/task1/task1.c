@@ -1,10 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include "fork_server.h"
 
-int main() {
+// --server: ask a running elemental_server to run the elemental instead of fork + exec
+static int transformThroughServer(const char *path, int choice) {
+    static const char *names[] = {"fire", "water", "earth", "air"};
+    if (choice < 1 || choice > 4) {
+        printf("Invalid choice. Exiting.\n");
+        return 1;
+    }
+
+    int fd = fs_connect(path);
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    char *out;
+    uint32_t len;
+    int status = fs_run(fd, names[choice - 1], &out, &len);
+    close(fd);
+    if (status < 0) {
+        fprintf(stderr, "Connection to %s lost\n", path);
+        return 1;
+    }
+    fwrite(out, 1, len, stdout);
+    printf("Parent process: server child exited with status %d\n", status);
+    free(out);
+    return 0;
+}
+
+// Usage: ./task1 [--server [socket_path]]
+int main(int argc, char **argv) {
     printf("Welcome to the Enchanted Fork and Exec Journey!\n");
     printf("Choose an element to transform into:\n");
     printf("1. Fire\n2. Water\n3. Earth\n4. Air\n");
@@ -13,30 +43,57 @@ int main() {
     
     int choice; 
 
-    scanf("%d", &choice);
+    if (scanf("%d", &choice) != 1) {
+        choice = 0;
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        return transformThroughServer(argc > 2 ? argv[2] : FS_DEFAULT_PATH, choice);
+    }
+
+    fflush(stdout); // otherwise the child inherits the unwritten menu and prints it again
 
     pid_t pid = fork();
 
     if (pid == 0) {
         printf("Child process: PID = %d\n", getpid());
 
+        fflush(stdout);
+
+        // execv() needs an argument list: at least the program name, ended by NULL
+        char *fire[] = {"./fire_elemental", NULL};
+        char *water[] = {"./water_elemental", NULL};
+        char *earth[] = {"./earth_elemental", NULL};
+        char *air[] = {"./air_elemental", NULL};
+
         switch (choice) {
         case 1:
-            execv("./fire_elemental", NULL);
+            execv(fire[0], fire);
             break;
         case 2:
-            execv("./water_elemental", NULL);
+            execv(water[0], water);
             break;
         case 3:
-            execv("./earth_elemental", NULL);
+            execv(earth[0], earth);
             break;
         case 4:
-            execv("./air_elemental", NULL);
+            execv(air[0], air);
             break;
         default:
             printf("Invalid choice. Exiting.\n");
             exit(1);
         }
+        perror("execv"); // only reached if the program could not be started
+        exit(127);
+    } else if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+
+    // Wait for the child, so it does not stay behind as a zombie
+    int status;
+    if (waitpid(pid, &status, 0) == pid && WIFEXITED(status)) {
+        printf("Parent process: child %d exited with status %d\n", pid, WEXITSTATUS(status));
     }
 
     return 0;
@@ -1,6 +1,13 @@
 #include <stdio.h>
+#include "elementals.h"
 
-int main() {
+int water_elemental_main(void) {
     printf("Transformation complete! You are now the Water Elemental!\n");
     return 0;
-}
\ No newline at end of file
+}
+
+#ifndef ELEMENTAL_NO_MAIN // elemental_server links all four elementals into one program
+int main() {
+    return water_elemental_main();
+}
+#endif
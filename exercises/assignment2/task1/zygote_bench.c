@@ -0,0 +1,139 @@
+/*
+ * Startup latency of one elemental, from request until its output and exit status are back:
+ * fork+exec and posix_spawn of ./fire_elemental versus a request to elemental_server, which
+ * forks an already-initialized copy of itself. The bench starts its own server.
+ *
+ *   ./zygote_bench [runs]    (default 2000)
+ */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+#include "fork_server.h"
+
+extern char **environ;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Runs ./fire_elemental with stdout on a pipe, reads it all and reaps it, like the server does */
+static int run_exec(int use_spawn, char *buf, size_t cap) {
+    char *argv[] = {"./fire_elemental", NULL};
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0) return -1;
+    pid_t pid;
+    if (use_spawn) {
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, pipefd[1], STDOUT_FILENO);
+        if (posix_spawn(&pid, argv[0], &actions, NULL, argv, environ) != 0) pid = -1;
+        posix_spawn_file_actions_destroy(&actions);
+    } else {
+        pid = fork();
+        if (pid == 0) {
+            dup2(pipefd[1], STDOUT_FILENO);
+            execv(argv[0], argv);
+            _exit(127);
+        }
+    }
+    close(pipefd[1]);
+    size_t len = 0;
+    ssize_t n;
+    while ((n = read(pipefd[0], buf + len, cap - len)) > 0) len += (size_t)n;
+    close(pipefd[0]);
+    int status = -1;
+    if (pid > 0) waitpid(pid, &status, 0);
+    return len > 0 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void report(const char *what, double *lat, int runs) {
+    qsort(lat, (size_t)runs, sizeof(double), cmp_double);
+    double sum = 0;
+    for (int i = 0; i < runs; i++) sum += lat[i];
+    printf("%-22s %10.1f %10.1f %10.1f %10.1f %12.0f\n", what, sum / runs, lat[runs / 2], lat[runs * 99 / 100],
+           lat[runs - 1], 1e6 * runs / sum);
+}
+
+int main(int argc, char **argv) {
+    int runs = (argc > 1) ? atoi(argv[1]) : 2000;
+    if (runs < 1) {
+        fprintf(stderr, "Usage: %s [runs]\n", argv[0]);
+        return 1;
+    }
+    if (access("./fire_elemental", X_OK) != 0 || access("./elemental_server", X_OK) != 0) {
+        fprintf(stderr, "./fire_elemental or ./elemental_server not found: run make first\n");
+        return 1;
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/zygote_bench.%d.sock", getpid());
+    char *server_argv[] = {"./elemental_server", path, NULL};
+    posix_spawn_file_actions_t quiet;
+    posix_spawn_file_actions_init(&quiet);
+    posix_spawn_file_actions_addopen(&quiet, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t server;
+    if (posix_spawn(&server, server_argv[0], &quiet, NULL, server_argv, environ) != 0) {
+        perror("posix_spawn");
+        return 1;
+    }
+    posix_spawn_file_actions_destroy(&quiet);
+    int fd = -1;
+    for (int tries = 0; fd < 0 && tries < 500; tries++) {
+        if ((fd = fs_connect(path)) < 0) usleep(10000);
+    }
+    if (fd < 0) {
+        perror("connect");
+        kill(server, SIGTERM);
+        return 1;
+    }
+
+    double *lat = malloc(sizeof(double) * (size_t)runs);
+    char buf[4096];
+    if (!lat) {
+        perror("malloc");
+        return 1;
+    }
+
+    printf("%d runs of fire_elemental, latency in microseconds\n", runs);
+    printf("%-22s %10s %10s %10s %10s %12s\n", "", "mean", "p50", "p99", "max", "runs/s");
+    for (int mode = 0; mode < 3; mode++) {
+        for (int i = 0; i < runs; i++) {
+            double t0 = now_us();
+            int status;
+            if (mode < 2) {
+                status = run_exec(mode == 1, buf, sizeof(buf));
+            } else {
+                char *out;
+                uint32_t len;
+                status = fs_run(fd, "fire", &out, &len);
+                if (status >= 0) free(out);
+            }
+            lat[i] = now_us() - t0;
+            if (status != 0) {
+                fprintf(stderr, "run %d failed with status %d\n", i, status);
+                kill(server, SIGTERM);
+                return 1;
+            }
+        }
+        report(mode == 0 ? "fork+exec" : mode == 1 ? "posix_spawn" : "fork server", lat, runs);
+    }
+
+    close(fd);
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    free(lat);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Large factorials with bigint.h: times n! with 1, 2, 4, ... threads, then checks the result.
+ *
+ *   ./bigfact [-p] [n] [max_threads]    (default n = 1000000, one thread per CPU; -p prints n!)
+ *
+ * Checks, none of which needs a stored copy of n!:
+ *   - n <= 34: equal to the factorial computed in 128-bit arithmetic
+ *   - 100!: equal to its well-known decimal expansion
+ *   - n! mod p for three primes p, against the same product taken mod p
+ *   - the power of two in n! is n - popcount(n) (Legendre)
+ *   - the digit count agrees with Kamenetsky's formula
+ *   - Wilson's theorem: (p - 1)! = p - 1 (mod p) for the largest prime p <= min(n + 1, 100003)
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "bigint.h"
+
+static const char *FACT_100 =
+    "93326215443944152681699238856266700490715968264381621468592963895217599993229915608941463976156518286253697920827223758"
+    "251185210916864000000000000000000000000";
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Decimal digits of x, from its two top limbs */
+static uint64_t digit_count(const big_t *x) {
+    if (x->n == 0) return 1;
+    double top = (double)x->d[x->n - 1] + (x->n > 1 ? (double)x->d[x->n - 2] / 18446744073709551616.0 : 0.0);
+    return (uint64_t)floor(log10(top) + 64.0 * (double)(x->n - 1) * log10(2.0)) + 1;
+}
+
+/* Kamenetsky: digits of n! = floor(n log10(n / e) + log10(2 pi n) / 2) + 1, for n >= 2 */
+static uint64_t kamenetsky(uint64_t n) {
+    double x = (double)n;
+    return (uint64_t)floor(x * log10(x / M_E) + log10(2.0 * M_PI * x) / 2.0) + 1;
+}
+
+static uint64_t mulmod(uint64_t a, uint64_t b, uint64_t m) {
+    return (uint64_t)((big_u128)a * b % m);
+}
+
+static int is_prime(uint64_t p) {
+    if (p < 2) return 0;
+    for (uint64_t d = 2; d * d <= p; d++) {
+        if (p % d == 0) return 0;
+    }
+    return 1;
+}
+
+static int report(const char *what, int ok) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static int check(uint64_t n, const big_t *f, tp_pool_t *pool) {
+    int ok = 1;
+    char what[96];
+
+    if (n <= 34) {
+        big_u128 ref = 1;
+        for (uint64_t i = 2; i <= n; i++) ref *= i;
+        big_t r = {NULL, 0};
+        uint64_t limbs[2] = {(uint64_t)ref, (uint64_t)(ref >> 64)};
+        r.d = limbs;
+        r.n = big_norm(limbs, 2);
+        ok &= report("equal to 128-bit arithmetic", r.n == f->n && memcmp(r.d, f->d, sizeof(uint64_t) * f->n) == 0);
+    }
+
+    big_t f100 = big_factorial(100, pool);
+    char *s = big_to_dec(&f100);
+    ok &= report("100! equal to its decimal expansion", strcmp(s, FACT_100) == 0);
+    free(s);
+    big_free(&f100);
+
+    static const uint64_t primes[] = {1000000007ull, 998244353ull, 2305843009213693951ull /* 2^61 - 1 */};
+    for (size_t k = 0; k < sizeof(primes) / sizeof(primes[0]); k++) {
+        uint64_t p = primes[k], ref = 1;
+        for (uint64_t i = 2; i <= n; i++) ref = mulmod(ref, i % p, p);
+        snprintf(what, sizeof(what), "n! mod %llu", (unsigned long long)p);
+        ok &= report(what, big_mod_u64(f, p) == ref);
+    }
+
+    ok &= report("power of two is n - popcount(n)", n < 2 || big_ctz(f) == n - (uint64_t)__builtin_popcountll(n));
+    if (n >= 2) {
+        snprintf(what, sizeof(what), "%llu digits (Kamenetsky)", (unsigned long long)kamenetsky(n));
+        ok &= report(what, digit_count(f) == kamenetsky(n));
+    }
+
+    uint64_t p = n + 1 < 100003 ? n + 1 : 100003;
+    while (p >= 2 && !is_prime(p)) p--;
+    if (p >= 3) {
+        big_t w = big_factorial(p - 1, pool);
+        snprintf(what, sizeof(what), "Wilson: (%llu - 1)! = -1 mod %llu", (unsigned long long)p, (unsigned long long)p);
+        ok &= report(what, big_mod_u64(&w, p) == p - 1);
+        big_free(&w);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    int print = 0, argi = 1;
+    if (argc > 1 && strcmp(argv[1], "-p") == 0) {
+        print = 1;
+        argi++;
+    }
+    long long n_arg = (argc > argi) ? atoll(argv[argi]) : 1000000;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = (argc > argi + 1) ? atoi(argv[argi + 1]) : (int)ncpu;
+    if (n_arg < 0 || max_threads < 1) {
+        fprintf(stderr, "Usage: %s [-p] [n] [max_threads]\n", argv[0]);
+        return 1;
+    }
+    uint64_t n = (uint64_t)n_arg;
+
+    big_t f = {NULL, 0};
+    uint64_t digits = 0;
+    double base = 0;
+    printf("%8s %10s %14s %8s\n", "threads", "seconds", "digits/s", "speedup");
+    for (int threads = 1;; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        /* The calling thread works too (tp_await() runs queued tasks), so threads - 1 workers */
+        tp_pool_t pool;
+        if (threads > 1 && tp_init(&pool, threads - 1, 4096) != 0) {
+            perror("tp_init");
+            return 1;
+        }
+        big_free(&f);
+        double start = now_sec();
+        f = big_factorial(n, threads > 1 ? &pool : NULL);
+        double elapsed = now_sec() - start;
+        if (threads > 1) tp_destroy(&pool);
+
+        digits = digit_count(&f);
+        if (threads == 1) base = elapsed;
+        printf("%8d %10.3f %14.0f %7.2fx\n", threads, elapsed, (double)digits / elapsed, base / elapsed);
+        fflush(stdout);
+        if (threads == max_threads) break;
+    }
+
+    printf("%llu! has %llu decimal digits (%llu bits)\n", (unsigned long long)n, (unsigned long long)digits,
+           (unsigned long long)big_bits(&f));
+    int ok = check(n, &f, NULL);
+
+    if (print) {
+        char *s = big_to_dec(&f);
+        printf("%s\n", s);
+        free(s);
+    }
+    big_free(&f);
+    return ok ? 0 : 1;
+}
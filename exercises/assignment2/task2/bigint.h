@@ -0,0 +1,378 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+/*
+ * Arbitrary-precision unsigned integers, just enough for large factorials.
+ *
+ * A number is an array of 64-bit limbs, least significant first. Multiplication is schoolbook
+ * below BIG_KARATSUBA_THRESHOLD limbs and Karatsuba above it (three half-size products instead
+ * of four). When a thread pool is given, the two outer Karatsuba products of large operands run
+ * as pool tasks while the calling thread computes the middle one.
+ *
+ * big_factorial(n) multiplies the odd parts of 1..n by binary splitting: products of two
+ * halves of the range, so the operands of every multiplication have about the same size. The
+ * halves of large ranges again run as pool tasks. The power of two removed from every factor is
+ * put back with one shift at the end.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "thread_pool.h"
+
+#define BIG_KARATSUBA_THRESHOLD 32 /* limbs: below this, schoolbook is faster */
+#define BIG_PARALLEL_THRESHOLD 1024 /* limbs: above this, Karatsuba's sub-products become tasks */
+#define BIG_LEAF_RANGE 256 /* factors multiplied one by one before splitting */
+#define BIG_PARALLEL_RANGE 4096 /* factors: above this, the two halves become tasks */
+
+typedef unsigned __int128 big_u128;
+
+typedef struct {
+    uint64_t *d; /* limbs, least significant first */
+    size_t n; /* limbs in use; d[n - 1] != 0, and zero has n == 0 */
+} big_t;
+
+static inline size_t big_norm(const uint64_t *a, size_t n) {
+    while (n > 0 && a[n - 1] == 0) n--;
+    return n;
+}
+
+static inline void big_free(big_t *x) {
+    free(x->d);
+    x->d = NULL;
+    x->n = 0;
+}
+
+static inline big_t big_from_u64(uint64_t v) {
+    big_t x;
+    x.d = (uint64_t *)malloc(sizeof(uint64_t));
+    x.d[0] = v;
+    x.n = v ? 1 : 0;
+    return x;
+}
+
+/* ---------------------------------------------------------------------------------------- */
+/* Limb-array primitives                                                                     */
+/* ---------------------------------------------------------------------------------------- */
+
+/* r = a + b with an >= bn; r has room for an + 1 limbs. Returns the length of r. */
+static inline size_t big_add_limbs(uint64_t *r, const uint64_t *a, size_t an, const uint64_t *b, size_t bn) {
+    uint64_t carry = 0;
+    size_t i;
+    for (i = 0; i < bn; i++) {
+        big_u128 t = (big_u128)a[i] + b[i] + carry;
+        r[i] = (uint64_t)t;
+        carry = (uint64_t)(t >> 64);
+    }
+    for (; i < an; i++) {
+        big_u128 t = (big_u128)a[i] + carry;
+        r[i] = (uint64_t)t;
+        carry = (uint64_t)(t >> 64);
+    }
+    r[an] = carry;
+    return an + (carry ? 1 : 0);
+}
+
+/* a -= b in place, with a >= b and an >= bn */
+static inline void big_sub_limbs(uint64_t *a, size_t an, const uint64_t *b, size_t bn) {
+    uint64_t borrow = 0;
+    size_t i;
+    for (i = 0; i < bn; i++) {
+        uint64_t d = a[i] - b[i];
+        uint64_t b1 = a[i] < b[i];
+        a[i] = d - borrow;
+        borrow = b1 | (d < borrow);
+    }
+    for (; borrow && i < an; i++) {
+        borrow = a[i] == 0;
+        a[i]--;
+    }
+}
+
+/* r[off ..] += a; the carry stops within rn limbs */
+static inline void big_add_at(uint64_t *r, size_t rn, const uint64_t *a, size_t an, size_t off) {
+    uint64_t carry = 0;
+    size_t i;
+    for (i = 0; i < an; i++) {
+        big_u128 t = (big_u128)r[off + i] + a[i] + carry;
+        r[off + i] = (uint64_t)t;
+        carry = (uint64_t)(t >> 64);
+    }
+    for (i = off + an; carry && i < rn; i++) {
+        carry = ++r[i] == 0;
+    }
+}
+
+/* r[0 .. an + bn) = a * b, schoolbook */
+static inline void big_mul_basecase(uint64_t *r, const uint64_t *a, size_t an, const uint64_t *b, size_t bn) {
+    memset(r, 0, sizeof(uint64_t) * (an + bn));
+    for (size_t i = 0; i < bn; i++) {
+        uint64_t bi = b[i], carry = 0;
+        if (bi == 0) continue;
+        for (size_t j = 0; j < an; j++) {
+            big_u128 t = (big_u128)a[j] * bi + r[i + j] + carry;
+            r[i + j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        r[i + an] = carry;
+    }
+}
+
+static void big_mul_limbs(uint64_t *r, const uint64_t *a, size_t an, const uint64_t *b, size_t bn, tp_pool_t *pool);
+
+typedef struct {
+    uint64_t *r;
+    const uint64_t *a, *b;
+    size_t an, bn;
+    tp_pool_t *pool;
+} big_mul_job_t;
+
+static void *big_mul_task(void *arg) {
+    big_mul_job_t *job = (big_mul_job_t *)arg;
+    big_mul_limbs(job->r, job->a, job->an, job->b, job->bn, job->pool);
+    return NULL;
+}
+
+/* r[0 .. an + bn) = a * b; r must not overlap a or b. pool may be NULL (single thread). */
+static void big_mul_limbs(uint64_t *r, const uint64_t *a, size_t an, const uint64_t *b, size_t bn, tp_pool_t *pool) {
+    if (an < bn) {
+        const uint64_t *t = a;
+        a = b;
+        b = t;
+        size_t tn = an;
+        an = bn;
+        bn = tn;
+    }
+    if (bn < BIG_KARATSUBA_THRESHOLD) {
+        big_mul_basecase(r, a, an, b, bn);
+        return;
+    }
+
+    if (an >= 2 * bn) {
+        /* Unbalanced: multiply b by bn-limb slices of a and add them up */
+        memset(r, 0, sizeof(uint64_t) * (an + bn));
+        uint64_t *t = (uint64_t *)malloc(sizeof(uint64_t) * 2 * bn);
+        for (size_t off = 0; off < an; off += bn) {
+            size_t cn = an - off < bn ? an - off : bn;
+            big_mul_limbs(t, a + off, cn, b, bn, pool);
+            big_add_at(r, an + bn, t, cn + bn, off);
+        }
+        free(t);
+        return;
+    }
+
+    /* Karatsuba: a = a1 * B^h + a0, b = b1 * B^h + b0 (bn > h since an < 2 * bn)
+     *   a * b = z2 * B^2h + (z1 - z0 - z2) * B^h + z0
+     *   z0 = a0 * b0, z2 = a1 * b1, z1 = (a0 + a1) * (b0 + b1) */
+    size_t h = an / 2;
+    const uint64_t *a0 = a, *a1 = a + h, *b0 = b, *b1 = b + h;
+    size_t a0n = big_norm(a0, h), b0n = big_norm(b0, h), a1n = an - h, b1n = bn - h;
+
+    big_mul_job_t j0 = {r, a0, b0, h, h, pool}; /* z0 goes straight into r[0 .. 2h) */
+    big_mul_job_t j2 = {r + 2 * h, a1, b1, a1n, b1n, pool}; /* z2 into r[2h .. an + bn) */
+    tp_future_t *f0 = NULL, *f2 = NULL;
+    if (pool && bn >= BIG_PARALLEL_THRESHOLD) {
+        f0 = tp_submit(pool, big_mul_task, &j0);
+        f2 = tp_submit(pool, big_mul_task, &j2);
+    }
+
+    uint64_t *sa = (uint64_t *)malloc(sizeof(uint64_t) * (a1n + 1));
+    uint64_t *sb = (uint64_t *)malloc(sizeof(uint64_t) * ((b1n > h ? b1n : h) + 1));
+    size_t san = a1n >= a0n ? big_add_limbs(sa, a1, a1n, a0, a0n) : big_add_limbs(sa, a0, a0n, a1, a1n);
+    size_t sbn = b1n >= b0n ? big_add_limbs(sb, b1, b1n, b0, b0n) : big_add_limbs(sb, b0, b0n, b1, b1n);
+    uint64_t *z1 = (uint64_t *)malloc(sizeof(uint64_t) * (san + sbn));
+    big_mul_limbs(z1, sa, san, sb, sbn, pool);
+    free(sa);
+    free(sb);
+
+    if (f0) {
+        tp_await(pool, f0);
+    } else {
+        big_mul_task(&j0);
+    }
+    if (f2) {
+        tp_await(pool, f2);
+    } else {
+        big_mul_task(&j2);
+    }
+
+    size_t z1n = san + sbn;
+    big_sub_limbs(z1, z1n, r, big_norm(r, 2 * h));
+    big_sub_limbs(z1, z1n, r + 2 * h, big_norm(r + 2 * h, an + bn - 2 * h));
+    big_add_at(r, an + bn, z1, big_norm(z1, z1n), h);
+    free(z1);
+}
+
+/* ---------------------------------------------------------------------------------------- */
+/* Numbers                                                                                   */
+/* ---------------------------------------------------------------------------------------- */
+
+static inline big_t big_mul(const big_t *a, const big_t *b, tp_pool_t *pool) {
+    big_t r;
+    r.d = (uint64_t *)malloc(sizeof(uint64_t) * (a->n + b->n + 1));
+    big_mul_limbs(r.d, a->d, a->n, b->d, b->n, pool);
+    r.n = big_norm(r.d, a->n + b->n);
+    return r;
+}
+
+/* x *= m */
+static inline void big_mul_u64(big_t *x, uint64_t m) {
+    uint64_t carry = 0;
+    for (size_t i = 0; i < x->n; i++) {
+        big_u128 t = (big_u128)x->d[i] * m + carry;
+        x->d[i] = (uint64_t)t;
+        carry = (uint64_t)(t >> 64);
+    }
+    if (carry) {
+        x->d = (uint64_t *)realloc(x->d, sizeof(uint64_t) * (x->n + 1));
+        x->d[x->n++] = carry;
+    }
+    if (m == 0) x->n = 0;
+}
+
+static inline big_t big_add(const big_t *a, const big_t *b) {
+    if (a->n < b->n) {
+        const big_t *t = a;
+        a = b;
+        b = t;
+    }
+    big_t r;
+    r.d = (uint64_t *)malloc(sizeof(uint64_t) * (a->n + 1));
+    r.n = big_add_limbs(r.d, a->d, a->n, b->d, b->n);
+    return r;
+}
+
+/* x <<= bits */
+static inline void big_shl(big_t *x, uint64_t bits) {
+    if (x->n == 0 || bits == 0) return;
+    size_t limbs = (size_t)(bits / 64), s = (size_t)(bits % 64);
+    uint64_t *d = (uint64_t *)calloc(x->n + limbs + 1, sizeof(uint64_t));
+    for (size_t i = 0; i < x->n; i++) {
+        d[i + limbs] |= x->d[i] << s;
+        if (s) d[i + limbs + 1] = x->d[i] >> (64 - s);
+    }
+    free(x->d);
+    x->d = d;
+    x->n = big_norm(d, x->n + limbs + 1);
+}
+
+static inline uint64_t big_mod_u64(const big_t *x, uint64_t m) {
+    big_u128 rem = 0;
+    for (size_t i = x->n; i-- > 0;) {
+        rem = ((rem << 64) | x->d[i]) % m;
+    }
+    return (uint64_t)rem;
+}
+
+static inline uint64_t big_bits(const big_t *x) {
+    return x->n ? (uint64_t)x->n * 64 - (uint64_t)__builtin_clzll(x->d[x->n - 1]) : 0;
+}
+
+/* Number of trailing zero bits (0 for zero) */
+static inline uint64_t big_ctz(const big_t *x) {
+    for (size_t i = 0; i < x->n; i++) {
+        if (x->d[i]) return (uint64_t)i * 64 + (uint64_t)__builtin_ctzll(x->d[i]);
+    }
+    return 0;
+}
+
+/* Decimal string (caller frees). Repeated division by 10^19: quadratic, meant for results up
+ * to a few hundred thousand digits. */
+static inline char *big_to_dec(const big_t *x) {
+    const uint64_t base = 10000000000000000000ull; /* 10^19 */
+    size_t n = x->n;
+    if (n == 0) {
+        char *s = (char *)malloc(2);
+        strcpy(s, "0");
+        return s;
+    }
+    uint64_t *t = (uint64_t *)malloc(sizeof(uint64_t) * n);
+    uint64_t *chunks = (uint64_t *)malloc(sizeof(uint64_t) * (n * 2 + 1)); /* 10^19 chunks, low first */
+    memcpy(t, x->d, sizeof(uint64_t) * n);
+    size_t nchunks = 0;
+    while (n > 0) {
+        big_u128 rem = 0;
+        for (size_t i = n; i-- > 0;) {
+            big_u128 cur = (rem << 64) | t[i];
+            t[i] = (uint64_t)(cur / base);
+            rem = cur % base;
+        }
+        chunks[nchunks++] = (uint64_t)rem;
+        n = big_norm(t, n);
+    }
+    char *s = (char *)malloc(nchunks * 19 + 1);
+    int len = sprintf(s, "%llu", (unsigned long long)chunks[nchunks - 1]);
+    for (size_t i = nchunks - 1; i-- > 0;) {
+        len += sprintf(s + len, "%019llu", (unsigned long long)chunks[i]);
+    }
+    free(t);
+    free(chunks);
+    return s;
+}
+
+/* ---------------------------------------------------------------------------------------- */
+/* Factorial                                                                                 */
+/* ---------------------------------------------------------------------------------------- */
+
+typedef struct {
+    uint64_t lo, hi;
+    tp_pool_t *pool;
+    big_t result;
+} big_range_job_t;
+
+/* Product of the odd parts of lo, lo + 1, ..., hi - 1 */
+static void *big_odd_product_task(void *arg) {
+    big_range_job_t *job = (big_range_job_t *)arg;
+    uint64_t lo = job->lo, hi = job->hi;
+
+    if (hi - lo <= BIG_LEAF_RANGE) {
+        /* Pack as many factors as fit into one limb before touching the big number */
+        big_t x = big_from_u64(1);
+        uint64_t acc = 1;
+        for (uint64_t i = lo; i < hi; i++) {
+            uint64_t m = i >> __builtin_ctzll(i);
+            big_u128 t = (big_u128)acc * m;
+            if (t >> 64) {
+                big_mul_u64(&x, acc);
+                acc = m;
+            } else {
+                acc = (uint64_t)t;
+            }
+        }
+        big_mul_u64(&x, acc);
+        job->result = x;
+        return NULL;
+    }
+
+    uint64_t mid = lo + (hi - lo) / 2;
+    big_range_job_t left = {lo, mid, job->pool, {NULL, 0}};
+    big_range_job_t right = {mid, hi, job->pool, {NULL, 0}};
+    if (job->pool && hi - lo >= BIG_PARALLEL_RANGE) {
+        tp_future_t *f = tp_submit(job->pool, big_odd_product_task, &left);
+        big_odd_product_task(&right);
+        if (f) {
+            tp_await(job->pool, f);
+        } else {
+            big_odd_product_task(&left); /* out of memory for the future: do it here */
+        }
+    } else {
+        big_odd_product_task(&left);
+        big_odd_product_task(&right);
+    }
+    job->result = big_mul(&left.result, &right.result, job->pool);
+    big_free(&left.result);
+    big_free(&right.result);
+    return NULL;
+}
+
+/* n!, using the pool's workers (and the calling thread) if pool is not NULL */
+static inline big_t big_factorial(uint64_t n, tp_pool_t *pool) {
+    if (n < 2) return big_from_u64(1);
+    big_range_job_t job = {1, n + 1, pool, {NULL, 0}};
+    big_odd_product_task(&job);
+    big_shl(&job.result, n - (uint64_t)__builtin_popcountll(n)); /* 2^(power of 2 in n!) */
+    return job.result;
+}
+
+#endif
@@ -1,44 +1,79 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
+#include <unistd.h>
+#include "bigint.h"
+#include "thread_pool.h"
 
-#define NUM_THREADS 5 // Number of threads to be created
-int arr[NUM_THREADS] = {1, 2, 3, 4, 5}; // Array containing the numbers for which factorial will be calculated
-int result = 0; // Global variable to store the final result (sum of squares of factorials)
+#define NUM_DEFAULT 5 // Factorials computed when no numbers are given
+int arr[NUM_DEFAULT] = {1, 2, 3, 4, 5}; // Array containing the numbers for which factorial will be calculated
 
 typedef struct {
     int num; // Number for which factorial is to be calculated
-    int factorial; // Factorial of the number
+    big_t factorial; // Factorial of the number (arbitrary precision: an int overflows at 13!)
 } ThreadParams;
 
 void* factorion(void* arg) {
     ThreadParams *params = (ThreadParams*)arg;
     printf("Thread %lu calculating factorial of %d\n", (unsigned long)pthread_self(), params->num);
-    for (int i = 1; i <= params->num; i++) { 
-        params->factorial *= i;
-    }
-    pthread_exit(NULL);
+    params->factorial = big_factorial((uint64_t)params->num, NULL);
+    return params; // handed back through the task's future
 }
 
-int main() {
-    pthread_t tids[NUM_THREADS];
-    ThreadParams params[NUM_THREADS];
+// Usage: ./task2 [numbers...]   (default 1 2 3 4 5)
+int main(int argc, char** argv) {
+    int count = argc > 1 ? argc - 1 : NUM_DEFAULT;
+
+    // A fixed pool of worker threads (one per CPU) runs the factorials as tasks, so adding
+    // numbers adds tasks, not threads
+    tp_pool_t pool;
+    if (tp_init(&pool, (int)sysconf(_SC_NPROCESSORS_ONLN), (uint64_t)count) != 0) {
+        perror("tp_init");
+        return 1;
+    }
 
-    for (int i = 0; i < NUM_THREADS; i++) {
-        params[i].num = arr[i];
-        params[i].factorial = 1;
-        pthread_create(&tids[i], NULL, factorion, (void*)&params[i]);
+    tp_future_t **futures = malloc(sizeof(tp_future_t*) * (size_t)count);
+    ThreadParams *params = malloc(sizeof(ThreadParams) * (size_t)count);
+    if (!futures || !params) {
+        perror("malloc");
+        return 1;
     }
 
-    for (int i = 0; i < NUM_THREADS; i++) {
-        pthread_join(tids[i], NULL);
+    for (int i = 0; i < count; i++) {
+        params[i].num = argc > 1 ? atoi(argv[i + 1]) : arr[i];
+        if (params[i].num < 0) {
+            fprintf(stderr, "Factorial of a negative number: %d\n", params[i].num);
+            return 1;
+        }
+        futures[i] = tp_submit(&pool, factorion, (void*)&params[i]);
+        if (!futures[i]) {
+            perror("tp_submit");
+            return 1;
+        }
+    }
 
-        int factorial = params[i].factorial;
+    // Only the main thread adds up the results, so the sum needs no synchronization
+    big_t result = big_from_u64(0);
+    for (int i = 0; i < count; i++) {
+        ThreadParams *done = tp_await(&pool, futures[i]);
 
-        printf("Factorial returned from this thread is %d\n", factorial);
+        char *factorial = big_to_dec(&done->factorial);
+        printf("Factorial returned from this thread is %s\n", factorial);
+        free(factorial);
 
-        result += factorial;
+        big_t sum = big_add(&result, &done->factorial);
+        big_free(&result);
+        big_free(&done->factorial);
+        result = sum;
     }
 
-    printf("Sum of factorials: %d\n", result);
+    tp_destroy(&pool);
+
+    char *sum = big_to_dec(&result);
+    printf("Sum of factorials: %s\n", sum);
+    free(sum);
+    big_free(&result);
+    free(futures);
+    free(params);
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,111 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+/*
+ * Ordered execution for N stages: stage k may run only after stage k - 1 has finished.
+ *
+ * The whole ordering state is one atomic counter, seq = the stage allowed to run next.
+ * A thread waiting for its stage first spins on seq (briefly, and only on multi-core
+ * machines), then parks on a futex. Each stage parks on its own 32-bit word, so
+ * sequencer_advance() wakes exactly the thread that owns the next stage instead of every
+ * waiter, and makes no system call at all when that thread is still spinning.
+ *
+ * Tickets may keep growing past nslots (stage k parks on word k % nslots), so the same
+ * sequencer can order several rounds. nslots must be at least the number of threads that can
+ * be waiting at the same time.
+ */
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define SEQ_SPIN_MAX 4096 /* upper bound for the adaptive spin */
+#define SEQ_SPIN_MIN 16 /* floor on multi-core machines, so a slow phase cannot switch spinning off for good */
+
+typedef struct {
+    _Atomic unsigned seq __attribute__((aligned(64))); /* next stage allowed to run */
+    _Atomic int spin_limit; /* adapts to how long hand-offs usually take */
+    unsigned nslots;
+    _Atomic unsigned *parked; /* parked[k % nslots] = 1 while stage k sleeps */
+} sequencer_t;
+
+static inline void seq_futex_wait(_Atomic unsigned *word, unsigned expected) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void seq_futex_wake(_Atomic unsigned *word) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+static inline void seq_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* Returns 0 on success, -1 if the slot array cannot be allocated */
+static inline int sequencer_init(sequencer_t *s, unsigned nslots) {
+    atomic_init(&s->seq, 0);
+    /* Spinning on a single CPU only delays the thread we are waiting for */
+    atomic_init(&s->spin_limit, sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 256 : 0);
+    s->nslots = nslots;
+    s->parked = (_Atomic unsigned *)calloc(nslots, sizeof(*s->parked));
+    return s->parked ? 0 : -1;
+}
+
+static inline void sequencer_destroy(sequencer_t *s) {
+    free((void *)s->parked);
+    s->parked = NULL;
+}
+
+/* Block until it is ticket's turn */
+static inline void sequencer_wait(sequencer_t *s, unsigned ticket) {
+    if (atomic_load_explicit(&s->seq, memory_order_acquire) == ticket) return;
+
+    int limit = atomic_load_explicit(&s->spin_limit, memory_order_relaxed);
+    for (int i = 0; i < limit; i++) {
+        seq_cpu_relax();
+        if (atomic_load_explicit(&s->seq, memory_order_acquire) == ticket) {
+            /* Spinning paid off: allow a little more next time */
+            if (limit < SEQ_SPIN_MAX) atomic_store_explicit(&s->spin_limit, limit + limit / 8 + 1, memory_order_relaxed);
+            return;
+        }
+    }
+    /* Spinning did not pay off: spin less next time, but keep enough to notice when it would */
+    if (limit > SEQ_SPIN_MIN) {
+        int less = limit - limit / 8 - 1;
+        atomic_store_explicit(&s->spin_limit, less > SEQ_SPIN_MIN ? less : SEQ_SPIN_MIN, memory_order_relaxed);
+    }
+
+    _Atomic unsigned *slot = &s->parked[ticket % s->nslots];
+    for (;;) {
+        atomic_store_explicit(slot, 1, memory_order_relaxed);
+        /* Pairs with the fence in sequencer_advance(): either we see the new seq here, or the
+         * advancing thread sees parked == 1 and wakes us */
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&s->seq, memory_order_acquire) == ticket) {
+            atomic_store_explicit(slot, 0, memory_order_relaxed);
+            return;
+        }
+        seq_futex_wait(slot, 1);
+        if (atomic_load_explicit(&s->seq, memory_order_acquire) == ticket) {
+            atomic_store_explicit(slot, 0, memory_order_relaxed); /* in case the wake-up was spurious */
+            return;
+        }
+    }
+}
+
+/* Finish the current stage and let the next one run */
+static inline void sequencer_advance(sequencer_t *s) {
+    unsigned next = atomic_load_explicit(&s->seq, memory_order_relaxed) + 1;
+    atomic_store_explicit(&s->seq, next, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+    _Atomic unsigned *slot = &s->parked[next % s->nslots];
+    if (atomic_load_explicit(slot, memory_order_relaxed) && atomic_exchange_explicit(slot, 0, memory_order_relaxed)) {
+        seq_futex_wake(slot);
+    }
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Hand-offs per second for N ordered threads: sequencer.h versus one semaphore per slot
+ * (the original task1.c scheme). Each thread owns stages n, n + N, n + 2N, ..., so the baton
+ * goes around the ring of threads `rounds` times.
+ *
+ *   ./sequencer_bench [max_threads]    (default 10000)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "sequencer.h"
+#include "futex_hash.h"
+
+#define TARGET_HANDOFFS 200000
+#define STACK_SIZE (64 * 1024) /* 10000 threads with default 8 MB stacks would not fit */
+
+static int nthreads;
+static int rounds;
+static pthread_barrier_t start_line;
+static unsigned long next_expected; /* checks that stages really run in order */
+static int out_of_order;
+
+static sequencer_t seq;
+static sem_t *slots;
+
+static void run_stage(unsigned stage) {
+    if (next_expected != stage) out_of_order = 1;
+    next_expected = stage + 1;
+}
+
+static void *seq_worker(void *arg) {
+    unsigned n = (unsigned)(long)arg;
+    pthread_barrier_wait(&start_line);
+    for (int r = 0; r < rounds; r++) {
+        unsigned stage = (unsigned)r * (unsigned)nthreads + n;
+        sequencer_wait(&seq, stage);
+        run_stage(stage);
+        sequencer_advance(&seq);
+    }
+    return NULL;
+}
+
+static void *sem_worker(void *arg) {
+    unsigned n = (unsigned)(long)arg;
+    pthread_barrier_wait(&start_line);
+    for (int r = 0; r < rounds; r++) {
+        unsigned stage = (unsigned)r * (unsigned)nthreads + n;
+        sem_wait(&slots[n]);
+        run_stage(stage);
+        sem_post(&slots[(n + 1) % (unsigned)nthreads]);
+    }
+    return NULL;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Returns hand-offs per second, or -1 on failure */
+static double run(void *(*worker)(void *)) {
+    pthread_t *tid = malloc(sizeof(pthread_t) * (size_t)nthreads);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, STACK_SIZE);
+    pthread_barrier_init(&start_line, NULL, (unsigned)nthreads + 1);
+    next_expected = 0;
+    out_of_order = 0;
+
+    for (int i = 0; i < nthreads; i++) {
+        if (pthread_create(&tid[i], &attr, worker, (void *)(long)i) != 0) {
+            fprintf(stderr, "pthread_create failed at thread %d\n", i);
+            exit(1);
+        }
+    }
+    /* Time only the hand-offs, not thread creation */
+    pthread_barrier_wait(&start_line);
+    double start = now_sec();
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    double elapsed = now_sec() - start;
+
+    pthread_barrier_destroy(&start_line);
+    pthread_attr_destroy(&attr);
+    free(tid);
+    if (out_of_order || next_expected != (unsigned long)nthreads * (unsigned long)rounds) {
+        fprintf(stderr, "stages ran out of order with %d threads\n", nthreads);
+        return -1;
+    }
+    return (double)nthreads * rounds / elapsed;
+}
+
+int main(int argc, char **argv) {
+    int max_threads = (argc > 1) ? atoi(argv[1]) : 10000;
+    static const int sizes[] = {7, 100, 1000, 10000};
+    if (max_threads < 7) {
+        fprintf(stderr, "Usage: %s [max_threads >= 7]\n", argv[0]);
+        return 1;
+    }
+
+    /* Up to max_threads stages park at once, on the sequencer's slots or on the semaphores */
+    futex_hash_reserve((unsigned)max_threads);
+
+    printf("%8s %8s %16s %16s %8s\n", "threads", "rounds", "sequencer/s", "semaphores/s", "speedup");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && sizes[i] <= max_threads; i++) {
+        nthreads = sizes[i];
+        rounds = TARGET_HANDOFFS / nthreads;
+        if (rounds < 3) rounds = 3;
+
+        if (sequencer_init(&seq, (unsigned)nthreads) != 0) {
+            perror("sequencer_init");
+            return 1;
+        }
+        double s = run(seq_worker);
+        sequencer_destroy(&seq);
+
+        slots = malloc(sizeof(sem_t) * (size_t)nthreads);
+        for (int k = 0; k < nthreads; k++) {
+            sem_init(&slots[k], 0, k == 0 ? 1u : 0u);
+        }
+        double m = run(sem_worker);
+        for (int k = 0; k < nthreads; k++) {
+            sem_destroy(&slots[k]);
+        }
+        free(slots);
+
+        if (s < 0 || m < 0) return 1;
+        printf("%8d %8d %16.0f %16.0f %7.2fx\n", nthreads, rounds, s, m, s / m);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -4,72 +4,79 @@
 #ifdef _POSIX_THREADS
 # include <pthread.h>
 #endif
-#include <semaphore.h>
+#include "sequencer.h"
+#include "fastlog.h"
+#include "trace.h"
 
 void *text(void *arg);
 
 int code[] = {4, 6, 3, 1, 5, 0, 2};
 
-static sem_t S[7]; 
+static sequencer_t order; /* one counter: the case allowed to print next */
+
+/* Text of each case, logged as one event per case (see exercises/common/fastlog.h) */
+static const char *paragraphs[7] = {
+    "A semaphore S is an integer-valued variable which can take only non-negative values.\n"
+    "Exactly two operations are defined on a semaphore:\n\n",
+
+    "Signal(S): If there are processes that have been suspended on this semaphore,\n"
+    "wake one of them, else S := S + 1.\n\n",
+
+    "Wait(S): If S > 0 then S := S - 1, else suspend the execution of this process.\n"
+    "The process is said to be suspended on the semaphore S.\n\n",
+
+    "The semaphore has the following properties:\n\n",
+
+    "1. Signal(S) and Wait(S) are atomic instructions.\n"
+    "In particular, no instructions can be interleaved between the test that S > 0\n"
+    "and the decrement of S or the suspension of the calling process.\n\n",
+
+    "2. A semaphore must be given a non-negative initial value.\n\n",
+
+    "3. The Signal(S) operation must wake one of the suspended processes.\n"
+    "The definition does not specify which process will be awakened.\n\n",
+};
 
 int main() {
     int i;
     pthread_t tid[7];
     
-    for (i = 0; i < 7; i++) {
-        unsigned init = (i == 0) ? 1u : 0u;
-        sem_init(&S[i], 0, init);
+    if (sequencer_init(&order, 7) != 0) {
+        perror("sequencer_init");
+        return 1;
+    }
+    if (flog_init(paragraphs, 7, 0) != 0) {
+        perror("flog_init");
+        return 1;
     }
+    trace_init();
+    trace_thread_name("main", -1);
 
     for (i = 0; i < 7; i++) {
-        pthread_create(&tid[i], NULL, text, (void*)&code[i]);
+        trace_pthread_create(&tid[i], NULL, text, (void*)&code[i]);
     }
        
     for (i = 0; i < 7; i++) {
-        pthread_join(tid[i], NULL);
+        trace_pthread_join(tid[i], NULL);
     }
 
+    flog_shutdown();
+    trace_export("task1.trace.json");
+    sequencer_destroy(&order);
     return 0;
 }
 
 void *text(void *arg) {
     int n = *(int*)arg;
+    trace_thread_name("Case", n);
 
-    sem_wait(&S[n]);
-
-    switch (n) {
-        case 0:
-            printf("A semaphore S is an integer-valued variable which can take only non-negative values.\n");
-            printf("Exactly two operations are defined on a semaphore:\n\n");
-            break;
-        case 1:
-            printf("Signal(S): If there are processes that have been suspended on this semaphore,\n");
-            printf("wake one of them, else S := S + 1.\n\n");
-            break;
-        case 2:
-            printf("Wait(S): If S > 0 then S := S - 1, else suspend the execution of this process.\n");
-            printf("The process is said to be suspended on the semaphore S.\n\n");
-            break;
-        case 3:
-            printf("The semaphore has the following properties:\n\n");
-            break;
-        case 4:
-            printf("1. Signal(S) and Wait(S) are atomic instructions.\n");
-            printf("In particular, no instructions can be interleaved between the test that S > 0\n");
-            printf("and the decrement of S or the suspension of the calling process.\n\n");
-            break;
-        case 5:
-            printf("2. A semaphore must be given a non-negative initial value.\n\n");
-            break;
-        case 6:
-            printf("3. The Signal(S) operation must wake one of the suspended processes.\n");
-            printf("The definition does not specify which process will be awakened.\n\n");
-            break;
-    }
+    uint64_t start = trace_now();
+    sequencer_wait(&order, (unsigned)n);
+    trace_span("sequencer_wait", "case", n, start);
+
+    flog(n); /* the paragraph of case n; printed by the logger thread, in this order */
 
-    if (n < 6) {
-        sem_post(&S[n + 1]);        
-    }                               
+    sequencer_advance(&order); /* wakes the thread for case n + 1, if it is asleep */
 
     pthread_exit(0);
 }
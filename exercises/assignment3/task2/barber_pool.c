@@ -0,0 +1,331 @@
+/*
+ * Generalized barber shop: K barbers, each with its own queue of assigned customers, that steal
+ * waiting customers from each other when they run out of work.
+ *
+ * A generator thread plays the customers: arrivals follow a Poisson process, service times are
+ * exponential. A customer who finds all N waiting chairs taken leaves (balks); otherwise they are
+ * assigned to one barber (round robin, or the barber with the fewest waiting customers) and
+ * appended to that barber's deque. Barbers serve their own deque oldest-first; an idle barber
+ * steals the oldest customer of another barber before going to sleep.
+ *
+ * Haircuts are busy-waits, so barbers compete for CPUs like real CPU-bound work. Waiting time is
+ * measured from the *scheduled* arrival time, so a generator that falls behind does not hide
+ * queueing delay.
+ *
+ *   ./barber_pool [-k max_barbers] [-n chairs] [-m customers] [-s service_us] [-r load] [-a rr|ll]
+ */
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define MAX_BARBERS 256
+
+typedef struct {
+    uint64_t arrival_ns; /* scheduled arrival */
+    uint64_t service_ns;
+} customer_t;
+
+/* Per-barber queue of assigned customers. A short mutex per barber is enough: the only
+ * contention is the generator appending and, rarely, a thief taking from the same barber. */
+typedef struct {
+    pthread_mutex_t lock;
+    customer_t *items; /* ring of `chairs` entries: a barber never has more waiting than that */
+    uint64_t head, tail;
+    _Atomic uint64_t size; /* read without the lock by the least-loaded assignment */
+} deque_t;
+
+/* Waiting times in nanoseconds: 16 linear sub-buckets per power of two (about 6% resolution) */
+#define HIST_SUB 16
+#define HIST_BUCKETS (64 * HIST_SUB)
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} hist_t;
+
+typedef struct {
+    int id;
+    pthread_t tid;
+    deque_t dq;
+    hist_t waits;
+    uint64_t served;
+    uint64_t stolen; /* customers this barber took from someone else's deque */
+    unsigned rng;
+} barber_t;
+
+/* Shop configuration */
+static int K = 1; /* barbers in the current run */
+static int max_barbers;
+static uint64_t chairs = 1024;
+static uint64_t customers = 1000000;
+static double service_us = 10.0; /* mean haircut */
+static double load = 0.7; /* offered work per barber: arrival rate = load * K / service */
+static int least_loaded;
+static int single_cpu; /* spinning for the next arrival would only delay the barbers */
+
+static barber_t barbers[MAX_BARBERS];
+static _Atomic uint64_t waiting; /* customers sitting in chairs, across all deques */
+static _Atomic int done; /* generator finished */
+static _Atomic unsigned work_seq; /* futex word idle barbers sleep on */
+static _Atomic int sleepers;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned xorshift(unsigned *s) {
+    unsigned x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *s = x;
+}
+
+/* Exponentially distributed value with the given mean */
+static double exp_sample(unsigned *rng, double mean) {
+    double u = (xorshift(rng) + 1.0) / 4294967297.0; /* (0, 1) */
+    return -log(u) * mean;
+}
+
+static void hist_record(hist_t *h, uint64_t v) {
+    size_t idx;
+    if (v < HIST_SUB) {
+        idx = (size_t)v;
+    } else {
+        int msb = 63 - __builtin_clzll(v);
+        idx = (size_t)((msb - 3) * HIST_SUB + ((v >> (msb - 4)) & (HIST_SUB - 1)));
+    }
+    h->counts[idx]++;
+    h->total++;
+    if (v > h->max) h->max = v;
+}
+
+/* Upper edge of bucket idx */
+static uint64_t hist_bucket_value(size_t idx) {
+    if (idx < HIST_SUB) return idx;
+    int msb = (int)(idx / HIST_SUB) + 3;
+    uint64_t sub = idx % HIST_SUB;
+    return ((HIST_SUB + sub + 1) << (msb - 4)) - 1;
+}
+
+static uint64_t hist_percentile(const hist_t *h, double pct) {
+    uint64_t rank = (uint64_t)ceil(pct / 100.0 * (double)h->total), seen = 0;
+    if (rank == 0) rank = 1;
+    for (size_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) return hist_bucket_value(i) < h->max ? hist_bucket_value(i) : h->max;
+    }
+    return h->max;
+}
+
+static void futex_wait(_Atomic unsigned *word, unsigned expected) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futex_wake(_Atomic unsigned *word, int n) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+/* ---------------------------------------------------------------------------------------- */
+
+static void deque_push(deque_t *d, customer_t c) {
+    pthread_mutex_lock(&d->lock);
+    d->items[d->tail++ % chairs] = c;
+    atomic_store_explicit(&d->size, d->tail - d->head, memory_order_relaxed);
+    pthread_mutex_unlock(&d->lock);
+}
+
+/* Take the oldest customer; used both by the owner and by thieves */
+static int deque_take(deque_t *d, customer_t *c) {
+    if (atomic_load_explicit(&d->size, memory_order_relaxed) == 0) return 0;
+    pthread_mutex_lock(&d->lock);
+    int ok = d->head != d->tail;
+    if (ok) {
+        *c = d->items[d->head++ % chairs];
+        atomic_store_explicit(&d->size, d->tail - d->head, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return ok;
+}
+
+/* Look through the other barbers' deques, starting at a random one */
+static int steal(barber_t *b, customer_t *c) {
+    int start = (int)(xorshift(&b->rng) % (unsigned)K);
+    for (int i = 0; i < K; i++) {
+        int victim = (start + i) % K;
+        if (victim != b->id && deque_take(&barbers[victim].dq, c)) return 1;
+    }
+    return 0;
+}
+
+static void *barber_main(void *arg) {
+    barber_t *b = (barber_t *)arg;
+    customer_t c;
+    for (;;) {
+        int got = deque_take(&b->dq, &c);
+        if (!got && steal(b, &c)) {
+            got = 1;
+            b->stolen++;
+        }
+        if (got) {
+            atomic_fetch_sub_explicit(&waiting, 1, memory_order_relaxed); /* the chair is free again */
+            uint64_t start = now_ns();
+            hist_record(&b->waits, start > c.arrival_ns ? start - c.arrival_ns : 0);
+            while (now_ns() - start < c.service_ns) {
+                /* cutting hair */
+            }
+            b->served++;
+            continue;
+        }
+
+        /* Nothing to do anywhere: sleep until the generator posts more work or finishes */
+        unsigned seq = atomic_load_explicit(&work_seq, memory_order_acquire);
+        if (atomic_load(&done) && atomic_load(&waiting) == 0) break;
+        atomic_fetch_add(&sleepers, 1);
+        if (atomic_load(&waiting) == 0 && !atomic_load(&done)) futex_wait(&work_seq, seq);
+        atomic_fetch_sub(&sleepers, 1);
+    }
+    return NULL;
+}
+
+static void wake_idle_barber(int all) {
+    if (atomic_load(&sleepers) > 0 || all) {
+        atomic_fetch_add_explicit(&work_seq, 1, memory_order_release);
+        futex_wake(&work_seq, all ? INT_MAX : 1);
+    }
+}
+
+static int pick_barber(uint64_t n) {
+    if (!least_loaded) return (int)(n % (uint64_t)K);
+    int best = 0;
+    uint64_t best_size = UINT64_MAX;
+    for (int i = 0; i < K; i++) {
+        uint64_t s = atomic_load_explicit(&barbers[i].dq.size, memory_order_relaxed);
+        if (s < best_size) {
+            best_size = s;
+            best = i;
+        }
+    }
+    return best;
+}
+
+/* One run with K barbers; prints one table row */
+static void run(void) {
+    atomic_store(&waiting, 0);
+    atomic_store(&done, 0);
+    atomic_store(&sleepers, 0);
+    for (int i = 0; i < K; i++) {
+        barber_t *b = &barbers[i];
+        memset(&b->waits, 0, sizeof(b->waits));
+        b->id = i;
+        b->served = b->stolen = 0;
+        b->rng = 0x9E3779B9u * (unsigned)(i + 1);
+        pthread_mutex_init(&b->dq.lock, NULL);
+        b->dq.items = malloc(sizeof(customer_t) * chairs);
+        b->dq.head = b->dq.tail = 0;
+        atomic_store(&b->dq.size, 0);
+        pthread_create(&b->tid, NULL, barber_main, b);
+    }
+
+    unsigned rng = 12345; /* same arrival sequence for every K */
+    double gap_ns = service_us * 1000.0 / (load * K);
+    uint64_t balked = 0;
+    uint64_t start = now_ns();
+    double next = (double)start;
+    for (uint64_t n = 0; n < customers; n++) {
+        next += exp_sample(&rng, gap_ns);
+        customer_t c = {(uint64_t)next, (uint64_t)exp_sample(&rng, service_us * 1000.0)};
+
+        /* Arrivals more than 50 us away: sleep; otherwise emit them as soon as they are due */
+        uint64_t now = now_ns();
+        if (c.arrival_ns > now + 50000) {
+            uint64_t sleep_ns = c.arrival_ns - now - 20000;
+            struct timespec ts = {(time_t)(sleep_ns / 1000000000u), (long)(sleep_ns % 1000000000u)};
+            nanosleep(&ts, NULL);
+        }
+        while (now_ns() < c.arrival_ns) {
+            if (single_cpu) sched_yield();
+        }
+
+        /* Take a waiting chair if one is free, else leave */
+        uint64_t w = atomic_load(&waiting);
+        do {
+            if (w >= chairs) break;
+        } while (!atomic_compare_exchange_weak(&waiting, &w, w + 1));
+        if (w >= chairs) {
+            balked++;
+            continue;
+        }
+        deque_push(&barbers[pick_barber(n)].dq, c);
+        wake_idle_barber(0);
+    }
+    atomic_store(&done, 1);
+    wake_idle_barber(1);
+
+    hist_t all;
+    memset(&all, 0, sizeof(all));
+    uint64_t served = 0, stolen = 0;
+    for (int i = 0; i < K; i++) {
+        barber_t *b = &barbers[i];
+        pthread_join(b->tid, NULL);
+        for (size_t j = 0; j < HIST_BUCKETS; j++) all.counts[j] += b->waits.counts[j];
+        all.total += b->waits.total;
+        if (b->waits.max > all.max) all.max = b->waits.max;
+        served += b->served;
+        stolen += b->stolen;
+        free(b->dq.items);
+        pthread_mutex_destroy(&b->dq.lock);
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    printf("%4d %11.0f %11.0f %6.2f%% %6.1f%% %9.1f %9.1f %9.1f %9.1f %10.1f\n", K,
+           1e9 / gap_ns, (double)served / elapsed, 100.0 * (double)balked / (double)customers,
+           served ? 100.0 * (double)stolen / (double)served : 0.0,
+           hist_percentile(&all, 50) / 1e3, hist_percentile(&all, 90) / 1e3, hist_percentile(&all, 99) / 1e3,
+           hist_percentile(&all, 99.9) / 1e3, all.max / 1e3);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    max_barbers = ncpu >= 4 ? (int)ncpu * 2 : 8;
+    single_cpu = ncpu == 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-k") == 0) max_barbers = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-n") == 0) chairs = (uint64_t)atoll(argv[i + 1]);
+        else if (strcmp(argv[i], "-m") == 0) customers = (uint64_t)atoll(argv[i + 1]);
+        else if (strcmp(argv[i], "-s") == 0) service_us = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0) load = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-a") == 0) least_loaded = strcmp(argv[i + 1], "ll") == 0;
+        else max_barbers = 0;
+    }
+    if (argc % 2 == 0 || max_barbers < 1 || max_barbers > MAX_BARBERS || chairs < 1 || customers < 1 ||
+        service_us <= 0 || load <= 0) {
+        fprintf(stderr, "Usage: %s [-k max_barbers 1..%d] [-n chairs] [-m customers] [-s service_us] "
+                        "[-r load per barber] [-a rr|ll]\n", argv[0], MAX_BARBERS);
+        return 1;
+    }
+
+    printf("%ld CPUs, %llu customers, %llu chairs, mean haircut %.1f us, load %.2f per barber, %s assignment\n",
+           ncpu, (unsigned long long)customers, (unsigned long long)chairs, service_us, load,
+           least_loaded ? "least-loaded" : "round-robin");
+    printf("%4s %11s %11s %7s %7s %9s %9s %9s %9s %10s\n", "K", "offered/s", "served/s", "balked",
+           "stolen", "wait p50", "p90", "p99", "p999", "max (us)");
+    for (K = 1; K <= max_barbers; K *= 2) {
+        run();
+    }
+    return 0;
+}
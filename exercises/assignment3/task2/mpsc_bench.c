@@ -0,0 +1,175 @@
+/*
+ * Waiting-room throughput with 1..64 producer threads: the lock-free ring in mpsc_ring.h versus
+ * the original mutex/empty/full semaphores. Producers push as fast as they can; a producer that
+ * finds the room full counts a balk and retries, so every item eventually gets through.
+ *
+ *   ./mpsc_bench [items] [chairs]    (defaults 2000000 and 64)
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "mpsc_ring.h"
+
+#define MAX_PRODUCERS 64
+
+static int nproducers;
+static int items_per_producer;
+static int chairs;
+static pthread_barrier_t start_line;
+static _Atomic long balks;
+static int fifo_broken;
+
+/* Lock-free ring */
+static mpsc_ring_t room;
+
+/* Semaphore version, as in the original task2.c */
+static sem_t mutex, empty, full;
+static int *buf;
+static int in_idx, out_idx;
+
+/* Items are (producer << 24) | k; each producer's k must reach the consumer in order */
+static void consume(int item, int *next) {
+    int p = item >> 24, k = item & 0xFFFFFF;
+    if (next[p] != k) fifo_broken = 1;
+    next[p] = k + 1;
+}
+
+static void *ring_producer(void *arg) {
+    int p = (int)(long)arg;
+    long my_balks = 0;
+    pthread_barrier_wait(&start_line);
+    for (int k = 0; k < items_per_producer; k++) {
+        while (!mpsc_try_push(&room, (p << 24) | k)) {
+            my_balks++;
+            sched_yield();
+        }
+    }
+    atomic_fetch_add(&balks, my_balks);
+    return NULL;
+}
+
+static void *ring_consumer(void *arg) {
+    int *next = calloc(MAX_PRODUCERS, sizeof(int));
+    long total = (long)nproducers * items_per_producer;
+    int item;
+    (void)arg;
+    for (long i = 0; i < total && mpsc_pop(&room, &item); i++) {
+        consume(item, next);
+        mpsc_release(&room);
+    }
+    free(next);
+    return NULL;
+}
+
+static void *sem_producer(void *arg) {
+    int p = (int)(long)arg;
+    long my_balks = 0;
+    pthread_barrier_wait(&start_line);
+    for (int k = 0; k < items_per_producer; k++) {
+        while (sem_trywait(&empty) != 0) {
+            my_balks++;
+            sched_yield();
+        }
+        sem_wait(&mutex);
+        buf[in_idx] = (p << 24) | k;
+        in_idx = (in_idx + 1) % chairs;
+        sem_post(&mutex);
+        sem_post(&full);
+    }
+    atomic_fetch_add(&balks, my_balks);
+    return NULL;
+}
+
+static void *sem_consumer(void *arg) {
+    int *next = calloc(MAX_PRODUCERS, sizeof(int));
+    long total = (long)nproducers * items_per_producer;
+    (void)arg;
+    for (long i = 0; i < total; i++) {
+        sem_wait(&full);
+        sem_wait(&mutex);
+        int item = buf[out_idx];
+        out_idx = (out_idx + 1) % chairs;
+        sem_post(&mutex);
+        consume(item, next);
+        sem_post(&empty);
+    }
+    free(next);
+    return NULL;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Returns items per second, or -1 if the per-producer order was violated */
+static double run(void *(*producer)(void *), void *(*consumer)(void *), long *balks_out) {
+    pthread_t prod[MAX_PRODUCERS], cons;
+    pthread_barrier_init(&start_line, NULL, (unsigned)nproducers + 1);
+    atomic_store(&balks, 0);
+    fifo_broken = 0;
+
+    pthread_create(&cons, NULL, consumer, NULL);
+    for (int p = 0; p < nproducers; p++) {
+        pthread_create(&prod[p], NULL, producer, (void *)(long)p);
+    }
+    pthread_barrier_wait(&start_line);
+    double start = now_sec();
+    for (int p = 0; p < nproducers; p++) {
+        pthread_join(prod[p], NULL);
+    }
+    pthread_join(cons, NULL);
+    double elapsed = now_sec() - start;
+    pthread_barrier_destroy(&start_line);
+
+    *balks_out = atomic_load(&balks);
+    if (fifo_broken) return -1;
+    return (double)nproducers * items_per_producer / elapsed;
+}
+
+int main(int argc, char **argv) {
+    long items = (argc > 1) ? atol(argv[1]) : 2000000;
+    chairs = (argc > 2) ? atoi(argv[2]) : 64;
+    if (items < MAX_PRODUCERS || items / MAX_PRODUCERS > 0xFFFFFF || chairs < 1) {
+        fprintf(stderr, "Usage: %s [items >= %d] [chairs >= 1]\n", argv[0], MAX_PRODUCERS);
+        return 1;
+    }
+
+    printf("%ld items through %d chairs\n", items, chairs);
+    printf("%9s %14s %12s %14s %12s %8s\n", "producers", "ring items/s", "ring balks", "sem items/s",
+           "sem balks", "speedup");
+    for (nproducers = 1; nproducers <= MAX_PRODUCERS; nproducers *= 2) {
+        items_per_producer = (int)(items / nproducers);
+
+        long ring_balks, sem_balks;
+        if (mpsc_init(&room, (uint64_t)chairs) != 0) {
+            perror("mpsc_init");
+            return 1;
+        }
+        double r = run(ring_producer, ring_consumer, &ring_balks);
+        mpsc_destroy(&room);
+
+        buf = malloc(sizeof(int) * (size_t)chairs);
+        in_idx = out_idx = 0;
+        sem_init(&mutex, 0, 1);
+        sem_init(&empty, 0, (unsigned)chairs);
+        sem_init(&full, 0, 0);
+        double s = run(sem_producer, sem_consumer, &sem_balks);
+        sem_destroy(&mutex);
+        sem_destroy(&empty);
+        sem_destroy(&full);
+        free(buf);
+
+        if (r < 0 || s < 0) {
+            fprintf(stderr, "FIFO order violated with %d producers\n", nproducers);
+            return 1;
+        }
+        printf("%9d %14.0f %12ld %14.0f %12ld %7.2fx\n", nproducers, r, ring_balks, s, sem_balks, r / s);
+        fflush(stdout);
+    }
+    return 0;
+}
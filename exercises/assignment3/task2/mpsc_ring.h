@@ -0,0 +1,177 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+/*
+ * Bounded lock-free multi-producer/single-consumer FIFO (the waiting room of the barber shop).
+ *
+ * Each cell carries a sequence number that says whose turn it is:
+ *   seq == 2 * pos                  free, producer with ticket pos may fill it
+ *   seq == 2 * pos + 1              filled, the consumer may take it
+ *   seq == 2 * (pos + capacity)     released again, for the producer one lap later
+ * (doubling keeps "filled" and "free for the next lap" apart even with a single chair)
+ *
+ * A producer claims a ticket with one CAS on tail and then writes its cell, so producers only
+ * contend on that one CAS instead of on a mutex held while writing the buffer. A producer that
+ * finds its cell still occupied gives up (mpsc_try_claim() returns 0): the "leave if no chair"
+ * rule. Service order is ticket order, so it stays FIFO.
+ *
+ * The consumer takes a cell with mpsc_pop() and frees it with mpsc_release(), so a chair can
+ * stay occupied until the haircut is over. It sleeps on a futex only when the ring is empty;
+ * producers make the wake-up system call only when it actually sleeps.
+ */
+
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef struct {
+    _Atomic uint64_t seq;
+    int value;
+} mpsc_cell_t;
+
+typedef struct {
+    _Atomic uint64_t tail __attribute__((aligned(64))); /* next ticket for producers */
+    _Atomic unsigned wake_seq __attribute__((aligned(64))); /* futex word the consumer sleeps on */
+    _Atomic unsigned consumer_sleeping;
+    _Atomic int closed;
+    _Atomic uint64_t head __attribute__((aligned(64))); /* written by the consumer only: next cell to take */
+    uint64_t released; /* consumer only: next cell to hand back */
+    uint64_t capacity; /* any size, not just powers of two */
+    mpsc_cell_t *cells;
+} mpsc_ring_t;
+
+static inline void mpsc_futex_wait(_Atomic unsigned *word, unsigned expected) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void mpsc_futex_wake(_Atomic unsigned *word) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Returns 0 on success, -1 if the cells cannot be allocated */
+static inline int mpsc_init(mpsc_ring_t *q, uint64_t capacity) {
+    q->cells = (mpsc_cell_t *)malloc(sizeof(mpsc_cell_t) * capacity);
+    if (!q->cells) return -1;
+    for (uint64_t i = 0; i < capacity; i++) atomic_init(&q->cells[i].seq, 2 * i);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->wake_seq, 0);
+    atomic_init(&q->consumer_sleeping, 0);
+    atomic_init(&q->closed, 0);
+    atomic_init(&q->head, 0);
+    q->released = 0;
+    q->capacity = capacity;
+    return 0;
+}
+
+static inline void mpsc_destroy(mpsc_ring_t *q) {
+    free(q->cells);
+    q->cells = NULL;
+}
+
+static inline void mpsc_wake_consumer(mpsc_ring_t *q) {
+    /* Pairs with the fence in mpsc_pop(): either the consumer sees our cell, or we see it asleep */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&q->consumer_sleeping, memory_order_relaxed)) {
+        atomic_store_explicit(&q->consumer_sleeping, 0, memory_order_relaxed);
+        atomic_fetch_add_explicit(&q->wake_seq, 1, memory_order_release);
+        mpsc_futex_wake(&q->wake_seq);
+    }
+}
+
+/* Claim the next chair without filling it yet. Returns 1 and stores the ticket (0-based
+ * position in arrival order) in *ticket, or 0 if there is no free cell. The consumer will not
+ * look past this cell until mpsc_publish() fills it, so publish promptly. */
+static inline int mpsc_try_claim(mpsc_ring_t *q, uint64_t *ticket) {
+    uint64_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (;;) {
+        mpsc_cell_t *cell = &q->cells[pos % q->capacity];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - 2 * pos);
+        if (diff == 0) {
+            /* The cell is free for ticket pos: claim it (on failure pos is reloaded) */
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                *ticket = pos;
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; /* still occupied from the previous lap: full */
+        } else {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed); /* another producer won */
+        }
+    }
+}
+
+/* Fill a claimed cell and hand it to the consumer */
+static inline void mpsc_publish(mpsc_ring_t *q, uint64_t ticket, int value) {
+    mpsc_cell_t *cell = &q->cells[ticket % q->capacity];
+    cell->value = value;
+    atomic_store_explicit(&cell->seq, 2 * ticket + 1, memory_order_release);
+    mpsc_wake_consumer(q);
+}
+
+/* Append value unless the ring is full. Returns 1 on success, 0 if there is no free cell. */
+static inline int mpsc_try_push(mpsc_ring_t *q, int value) {
+    uint64_t ticket;
+    if (!mpsc_try_claim(q, &ticket)) return 0;
+    mpsc_publish(q, ticket, value);
+    return 1;
+}
+
+/* Take the oldest value, sleeping while the ring is empty. Returns 0 once the ring is closed
+ * and empty. The cell stays occupied until mpsc_release(). */
+static inline int mpsc_pop(mpsc_ring_t *q, int *value) {
+    uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    mpsc_cell_t *cell = &q->cells[head % q->capacity];
+    for (;;) {
+        if (atomic_load_explicit(&cell->seq, memory_order_acquire) == 2 * head + 1) break;
+        if (atomic_load_explicit(&q->tail, memory_order_relaxed) != head) {
+            /* A producer claimed the cell and is about to fill it; let it run if it was preempted */
+            sched_yield();
+            continue;
+        }
+        if (atomic_load_explicit(&q->closed, memory_order_acquire)) return 0;
+
+        unsigned w = atomic_load_explicit(&q->wake_seq, memory_order_acquire);
+        atomic_store_explicit(&q->consumer_sleeping, 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&q->tail, memory_order_relaxed) != head ||
+            atomic_load_explicit(&q->closed, memory_order_acquire)) {
+            atomic_store_explicit(&q->consumer_sleeping, 0, memory_order_relaxed);
+            continue;
+        }
+        mpsc_futex_wait(&q->wake_seq, w);
+    }
+    *value = cell->value;
+    atomic_store_explicit(&q->head, head + 1, memory_order_relaxed);
+    return 1;
+}
+
+/* Free the oldest cell taken by mpsc_pop() */
+static inline void mpsc_release(mpsc_ring_t *q) {
+    mpsc_cell_t *cell = &q->cells[q->released % q->capacity];
+    atomic_store_explicit(&cell->seq, 2 * (q->released + q->capacity), memory_order_release);
+    q->released++;
+}
+
+/* Values pushed but not yet taken by mpsc_pop() (a snapshot) */
+static inline uint64_t mpsc_count(mpsc_ring_t *q) {
+    uint64_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    return atomic_load_explicit(&q->tail, memory_order_acquire) - head;
+}
+
+/* No more pushes will come: mpsc_pop() returns 0 once the remaining values are taken */
+static inline void mpsc_close(mpsc_ring_t *q) {
+    atomic_store_explicit(&q->closed, 1, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+    atomic_store_explicit(&q->consumer_sleeping, 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&q->wake_seq, 1, memory_order_release);
+    mpsc_futex_wake(&q->wake_seq);
+}
+
+#endif
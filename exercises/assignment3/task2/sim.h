@@ -0,0 +1,98 @@
+#ifndef SIM_H
+#define SIM_H
+
+/*
+ * Discrete-event simulation engine: a virtual clock and a binary min-heap of pending events.
+ *
+ * sim_schedule() files an event `delay` time units after the current virtual time, and
+ * sim_next() pops the earliest one and moves the clock to it. Nothing ever sleeps, so a run
+ * takes as long as the event handling, not as long as the simulated time. Events due at the
+ * same time come out in the order they were scheduled, so a run is fully determined by its
+ * inputs and the RNG seed.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct {
+    double time;
+    uint64_t seq; /* tie-breaker: scheduling order */
+    int type;
+    int data;
+} sim_event_t;
+
+typedef struct {
+    sim_event_t *heap;
+    size_t size, cap;
+    uint64_t next_seq;
+    double now; /* virtual clock */
+    uint64_t rng; /* state of sim_random() */
+} sim_t;
+
+static inline void sim_init(sim_t *s, uint64_t seed) {
+    s->heap = NULL;
+    s->size = s->cap = 0;
+    s->next_seq = 0;
+    s->now = 0;
+    s->rng = seed;
+}
+
+static inline void sim_destroy(sim_t *s) {
+    free(s->heap);
+    s->heap = NULL;
+    s->size = s->cap = 0;
+}
+
+/* splitmix64: a seeded, reproducible replacement for rand() */
+static inline uint64_t sim_random(sim_t *s) {
+    uint64_t z = (s->rng += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static inline int sim_before(const sim_event_t *a, const sim_event_t *b) {
+    return a->time < b->time || (a->time == b->time && a->seq < b->seq);
+}
+
+/* Returns 0 on success, -1 if the heap cannot grow */
+static inline int sim_schedule(sim_t *s, double delay, int type, int data) {
+    if (s->size == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 64;
+        sim_event_t *heap = (sim_event_t *)realloc(s->heap, sizeof(sim_event_t) * cap);
+        if (!heap) return -1;
+        s->heap = heap;
+        s->cap = cap;
+    }
+    sim_event_t ev = {s->now + delay, s->next_seq++, type, data};
+    size_t i = s->size++;
+    while (i > 0) { /* sift up */
+        size_t parent = (i - 1) / 2;
+        if (!sim_before(&ev, &s->heap[parent])) break;
+        s->heap[i] = s->heap[parent];
+        i = parent;
+    }
+    s->heap[i] = ev;
+    return 0;
+}
+
+/* Pop the earliest event and advance the clock to it. Returns 0 when no events are left. */
+static inline int sim_next(sim_t *s, sim_event_t *ev) {
+    if (s->size == 0) return 0;
+    *ev = s->heap[0];
+    s->now = ev->time;
+    sim_event_t last = s->heap[--s->size];
+    size_t i = 0;
+    for (;;) { /* sift down */
+        size_t child = 2 * i + 1;
+        if (child >= s->size) break;
+        if (child + 1 < s->size && sim_before(&s->heap[child + 1], &s->heap[child])) child++;
+        if (!sim_before(&s->heap[child], &last)) break;
+        s->heap[i] = s->heap[child];
+        i = child;
+    }
+    if (s->size > 0) s->heap[i] = last;
+    return 1;
+}
+
+#endif
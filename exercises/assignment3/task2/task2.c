@@ -1,22 +1,31 @@
 #include <pthread.h>
-#include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
 #include <time.h>
-
-#define MAX_CUSTOMERS 100
-#define MAX_CHAIRS    100
-
-static sem_t mutex; // binary semaphore: protects the waiting-room buffer
-static sem_t empty; // counting semaphore: number of free chairs (capacity N)
-static sem_t full; // counting semaphore: number of waiting customers (0..M)
+#include "mpsc_ring.h"
+#include "sim.h"
+#include "fastlog.h"
+#include "trace.h"
 
 static int N, M;
 
-// Circular buffer to carry customer IDs from producers -> consumer (FIFO) 
-static int buf[MAX_CHAIRS];
-static int in_idx = 0, out_idx = 0;
+// Waiting room: lock-free ring of N chairs carrying customer IDs from producers -> consumer (FIFO).
+// A chair stays taken until the haircut of the customer who sat in it is over.
+static mpsc_ring_t room;
+
+// What the threads print, one fastlog event each (see exercises/common/fastlog.h)
+enum { LOG_CUT_START, LOG_CUT_END, LOG_LEAVE_DONE, LOG_ARRIVE, LOG_SIT, LOG_BALK, LOG_BARBER_SLEEPS };
+static const char* events[] = {
+    "Barber starts cutting hair of Customer %ld for %ld s.\n",
+    "Barber finishes cutting hair of Customer %ld.\n",
+    "Customer %ld leaves after haircut.\n",
+    "Customer %ld arrives.\n",
+    "Customer %ld sits in Chair %ld in the waiting area.\n",
+    "Customer %ld leaves (no chairs).\n",
+    "Barber goes to sleep.\n",
+};
 
 static int random_delay() { 
     return 1 + rand() % 5; 
@@ -24,21 +33,25 @@ static int random_delay() {
 
 // Barber (Consumer) Thread
 void* barber(void* _) {
-    while (1) {
-        sem_wait(&full); // sleep until someone is waiting
-
-        sem_wait(&mutex);
-        int cid = buf[out_idx]; // take next customer ID (FIFO)
-        out_idx = (out_idx + 1) % N;
-        sem_post(&mutex);
+    int cid;
+    uint64_t served = 0; // customers leave the chairs in ticket order, so this one sat in chair served % N
+    trace_thread_name("Barber", -1);
+    for (;;) {
+        uint64_t start = trace_now();
+        int more = mpsc_pop(&room, &cid); // sleep until someone is waiting, take next customer ID (FIFO)
+        trace_span("wait for customer", NULL, 0, start);
+        if (!more) break;
 
         int secs = random_delay();
-        printf("Barber starts cutting hair of Customer %d for %d s.\n", cid + 1, secs);
+        flog(LOG_CUT_START, cid + 1, secs);
+        start = trace_now();
         sleep(secs);
-        printf("Barber finishes cutting hair of Customer %d.\n", cid + 1);
-        printf("Customer %d leaves after haircut.\n", cid + 1);
+        trace_span("cut hair", "customer", cid + 1, start);
+        flog(LOG_CUT_END, cid + 1);
+        flog(LOG_LEAVE_DONE, cid + 1);
 
-        sem_post(&empty); // one waiting chair becomes free
+        mpsc_release(&room); // one waiting chair becomes free
+        trace_async_end("chair", (int)(served++ % (uint64_t)N) + 1);
     }
 
     return NULL;
@@ -47,75 +60,185 @@ void* barber(void* _) {
 // Customer (Producer) Thread
 void* customer(void* arg) {
     int id = *(int*)arg;
+    trace_thread_name("Customer", id + 1);
 
-    printf("Customer %d arrives.\n", id + 1);
+    flog(LOG_ARRIVE, id + 1);
 
     // Try to claim a chair, if none, leave immediately
-    if (sem_trywait(&empty) == 0) {
-        sem_wait(&mutex);
-        int chair_num = in_idx + 1; // assign readable chair number (1-based)
-        buf[in_idx] = id;                  
-        in_idx = (in_idx + 1) % N;
-        printf("Customer %d sits in Chair %d in the waiting area.\n", id + 1, chair_num);
-        sem_post(&mutex);
-
-        sem_post(&full); // notify barber
+    uint64_t ticket;
+    if (mpsc_try_claim(&room, &ticket)) {
+        int chair_num = (int)(ticket % (uint64_t)N) + 1; // assign readable chair number (1-based)
+        flog(LOG_SIT, id + 1, chair_num);
+        trace_async_begin("chair", chair_num); // occupied until the barber releases it
+
+        mpsc_publish(&room, ticket, id); // notify barber
     } else {
-        printf("Customer %d leaves (no chairs).\n", id + 1);
+        flog(LOG_BALK, id + 1);
+        trace_instant("no chair", "customer", id + 1);
     }
 
     return NULL;
 }
 
+// ---------------------------------------------------------------------------------------
+// Simulation mode: the same shop on a virtual clock. Arrival gaps and haircuts are drawn like
+// random_delay() (1-5 s), a customer leaves if all N chairs are taken, and a chair stays taken
+// until its customer's haircut is over. Nothing sleeps, so millions of customers take seconds.
+// ---------------------------------------------------------------------------------------
+
+enum { EV_ARRIVE, EV_HAIRCUT_DONE };
+
+static int simulate(uint64_t seed, int verbose) {
+    sim_t sim;
+    sim_init(&sim, seed);
+
+    // Customers waiting for the barber, FIFO; occupied also counts the one in the barber's chair
+    int* queue = malloc(sizeof(int) * (size_t)N);
+    double* arrived = malloc(sizeof(double) * (size_t)M);
+    if (!queue || !arrived) {
+        perror("malloc");
+        return 1;
+    }
+    int q_head = 0, q_len = 0, occupied = 0, cutting = 0;
+    long served = 0, balked = 0;
+    int max_queue = 0;
+    double queue_area = 0, occupied_area = 0, total_wait = 0, last = 0;
+
+    sim_schedule(&sim, (double)(1 + sim_random(&sim) % 5), EV_ARRIVE, 0);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    sim_event_t ev;
+    while (sim_next(&sim, &ev)) {
+        // Time-weighted averages: the state held constant since the previous event
+        queue_area += q_len * (sim.now - last);
+        occupied_area += occupied * (sim.now - last);
+        last = sim.now;
+
+        int cid = ev.data;
+        if (ev.type == EV_ARRIVE) {
+            if (verbose) printf("[%9.0f s] Customer %d arrives.\n", sim.now, cid + 1);
+            if (occupied < N) {
+                occupied++;
+                queue[(q_head + q_len++) % N] = cid;
+                arrived[cid] = sim.now;
+                if (q_len > max_queue) max_queue = q_len;
+                if (verbose) printf("[%9.0f s] Customer %d sits in the waiting area.\n", sim.now, cid + 1);
+            } else {
+                balked++;
+                if (verbose) printf("[%9.0f s] Customer %d leaves (no chairs).\n", sim.now, cid + 1);
+            }
+            if (cid + 1 < M) sim_schedule(&sim, (double)(1 + sim_random(&sim) % 5), EV_ARRIVE, cid + 1);
+        } else {
+            if (verbose) printf("[%9.0f s] Barber finishes cutting hair of Customer %d.\n", sim.now, cid + 1);
+            occupied--; // the chair is free once the haircut is over
+            cutting = 0;
+            served++;
+        }
+
+        // The barber takes the next customer as soon as he is free
+        if (!cutting && q_len > 0) {
+            int next = queue[q_head];
+            q_head = (q_head + 1) % N;
+            q_len--;
+            total_wait += sim.now - arrived[next];
+            int secs = (int)(1 + sim_random(&sim) % 5);
+            if (verbose) printf("[%9.0f s] Barber starts cutting hair of Customer %d for %d s.\n", sim.now, next + 1, secs);
+            cutting = 1;
+            sim_schedule(&sim, (double)secs, EV_HAIRCUT_DONE, next);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double wall = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    printf("Simulated %d customers, %d chairs, seed %llu\n", M, N, (unsigned long long)seed);
+    printf("  virtual time      %.0f s\n", sim.now);
+    printf("  served            %ld\n", served);
+    printf("  balked            %ld (%.2f%%)\n", balked, 100.0 * (double)balked / M);
+    printf("  queue length      %.3f average, %d max (customers waiting for the barber)\n",
+           sim.now > 0 ? queue_area / sim.now : 0.0, max_queue);
+    printf("  chairs occupied   %.3f average\n", sim.now > 0 ? occupied_area / sim.now : 0.0);
+    printf("  wait before cut   %.3f s average\n", served > 0 ? total_wait / (double)served : 0.0);
+    printf("  wall time         %.3f s (%.0f customers/s)\n", wall, wall > 0 ? M / wall : 0.0);
+
+    free(queue);
+    free(arrived);
+    sim_destroy(&sim);
+    return 0;
+}
+
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <N_waiting_chairs> <M_customers>\n", argv[0]);
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <N_waiting_chairs> <M_customers> [--sim [seed] [-v]]\n", argv[0]);
         return 1;
     }
 
     N = atoi(argv[1]);  
     M = atoi(argv[2]);
-    if (N <= 0 || N > MAX_CHAIRS || M <= 0 || M > MAX_CUSTOMERS) {
-        fprintf(stderr, "Invalid args: 0 < N <= %d, 0 < M <= %d\n", MAX_CHAIRS, MAX_CUSTOMERS);
+    if (N <= 0 || M <= 0) {
+        fprintf(stderr, "Invalid args: N > 0, M > 0\n");
+        return 1;
+    }
+
+    if (argc > 3) {
+        if (strcmp(argv[3], "--sim") != 0) {
+            fprintf(stderr, "Unknown option %s\n", argv[3]);
+            return 1;
+        }
+        uint64_t seed = 1;
+        int verbose = 0;
+        for (int i = 4; i < argc; i++) {
+            if (strcmp(argv[i], "-v") == 0) verbose = 1;
+            else seed = strtoull(argv[i], NULL, 10);
+        }
+        return simulate(seed, verbose);
+    }
+
+    if (mpsc_init(&room, (uint64_t)N) != 0) {
+        perror("mpsc_init");
         return 1;
     }
 
-    sem_init(&mutex, 0, 1);
-    sem_init(&empty, 0, N);
-    sem_init(&full,  0, 0);
+    if (flog_init(events, sizeof(events) / sizeof(events[0]), 0) != 0) {
+        perror("flog_init");
+        return 1;
+    }
+
+    trace_init();
+    trace_thread_name("main", -1);
 
     pthread_t barberThread;
-    pthread_create(&barberThread, NULL, barber, NULL);
+    trace_pthread_create(&barberThread, NULL, barber, NULL);
 
-    pthread_t cthreads[MAX_CUSTOMERS];
-    int ids[MAX_CUSTOMERS];
+    pthread_t* cthreads = malloc(sizeof(pthread_t) * (size_t)M);
+    int* ids = malloc(sizeof(int) * (size_t)M);
+    if (!cthreads || !ids) {
+        perror("malloc");
+        return 1;
+    }
 
     // Create customers sequentially with random arrival times
     for (int i = 0; i < M; i++) {
         sleep(random_delay());       
         ids[i] = i;                  
-        pthread_create(&cthreads[i], NULL, customer, &ids[i]);
+        trace_pthread_create(&cthreads[i], NULL, customer, &ids[i]);
     }
 
     for (int i = 0; i < M; i++) {
-        pthread_join(cthreads[i], NULL);
+        trace_pthread_join(cthreads[i], NULL);
     }
+    free(cthreads);
+    free(ids);
 
-    // When 'full' hits 0, the queue is empty but the barber may still be cutting, so wait a bit (5 sec)
-    int f;
-    do {
-        sem_getvalue(&full, &f);
-        sleep(5);
-    } while (f > 0);
-
-    printf("Barber goes to sleep.\n");
+    // No more customers will come: close the room. The barber serves everyone still waiting,
+    // then mpsc_pop() returns 0 and his loop ends, so no polling or cancelling is needed.
+    mpsc_close(&room);
+    trace_pthread_join(barberThread, NULL);
 
-    // Stop the barber 
-    pthread_cancel(barberThread);
-    pthread_join(barberThread, NULL);
+    flog(LOG_BARBER_SLEEPS);
+    flog_shutdown();
+    trace_export("task2.trace.json");
 
-    sem_destroy(&mutex);
-    sem_destroy(&empty);
-    sem_destroy(&full);
+    mpsc_destroy(&room);
     return 0;
 }
\ No newline at end of file
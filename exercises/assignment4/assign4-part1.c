@@ -1,36 +1,50 @@
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
-
-#define MAX_THREADS 100
+#include <string.h>
+#include "thread_pool.h"
 
 static const char *NAME = "Romerico David";
 
 void createPhilosophers(int nthreads);
+void runPhilosophersOnPool(int nphilosophers, int nworkers);
 void *philosopherThread(void *pVoid);
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <N_Threads>\n", argv[0]);
+    if (argc != 2 && !(argc == 4 && strcmp(argv[2], "-w") == 0)) {
+        fprintf(stderr, "Usage: %s <N_Threads> [-w pool_workers]\n", argv[0]);
         return 1;
     }
 
     int nthreads = atoi(argv[1]);
-    if (nthreads <= 0 || nthreads > MAX_THREADS) {
-        fprintf(stderr, "Error: N must be in [1, %d]\n", MAX_THREADS);
+    if (nthreads <= 0) {
+        fprintf(stderr, "Error: N must be at least 1\n");
         return 1;
     }
 
     printf("%s: Assignment 4: # of threads = %d\n", NAME, nthreads);
 
-    createPhilosophers(nthreads);
+    if (argc == 4) {
+        int nworkers = atoi(argv[3]);
+        if (nworkers <= 0) {
+            fprintf(stderr, "Error: pool_workers must be at least 1\n");
+            return 1;
+        }
+        runPhilosophersOnPool(nthreads, nworkers);
+    } else {
+        createPhilosophers(nthreads);
+    }
 
     return 0;
 }
 
 void createPhilosophers(int nthreads) {
-    pthread_t tids[MAX_THREADS];
-    int philosopherIdx[MAX_THREADS];
+    pthread_t *tids = malloc(sizeof(pthread_t) * (size_t)nthreads);
+    int *philosopherIdx = malloc(sizeof(int) * (size_t)nthreads);
+    if (!tids || !philosopherIdx) {
+        perror("malloc");
+        exit(1);
+    }
 
     for (int i = 0; i < nthreads; i++) {
         philosopherIdx[i] = i;
@@ -42,10 +56,31 @@ void createPhilosophers(int nthreads) {
     }
 
     printf("%d threads have been completed/joined successfully!\n", nthreads);
+    free(tids);
+    free(philosopherIdx);
+}
+
+static void philosopherTask(uint64_t i, void *ctx) {
+    (void)ctx;
+    int idx = (int)i;
+    philosopherThread(&idx);
+}
+
+// Same philosophers as tasks on a fixed pool of worker threads (exercises/common/thread_pool.h)
+void runPhilosophersOnPool(int nphilosophers, int nworkers) {
+    tp_pool_t pool;
+    if (tp_init(&pool, nworkers, 1024) != 0) {
+        perror("tp_init");
+        exit(1);
+    }
+    tp_parallel_for(&pool, (uint64_t)nphilosophers, 1, philosopherTask, NULL);
+    tp_destroy(&pool);
+
+    printf("%d philosophers have been completed on %d pool threads successfully!\n", nphilosophers, nworkers);
 }
 
 void *philosopherThread(void *pVoid) {
     int idx = *(int *)pVoid;
     printf("This is philosopher %d\n", idx);
-    return NULL; 
+    return NULL;
 }
@@ -1,15 +1,33 @@
 #include <pthread.h>
 #include <semaphore.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <time.h>
+#include "chopsticks.h"
+#include "futex_hash.h"
+#include "thread_pool.h"
+#include "fastlog.h"
+#include "trace.h"
 
-#define MAX_THREADS 100
+#define STACK_SIZE (64 * 1024) /* 100k threads with default 8 MB stacks would not fit */
 
 static const char *NAME = "Romerico David";
 
+// What the threads print, one fastlog event each (see exercises/common/fastlog.h)
+enum { LOG_THINKING, LOG_STARTS_EATING, LOG_ENDS_EATING, LOG_THREADS_DONE, LOG_POOL_DONE };
+static const char *events[] = {
+    "Philosopher %ld: thinking\n",
+    "Philosopher %ld: starts eating\n",
+    "Philosopher %ld: ends eating\n",
+    "%ld threads have been completed/joined successfully!\n",
+    "%ld philosophers have been completed on %ld pool threads successfully!\n",
+};
+
 void createPhilosophers(int nthreads);
+void runPhilosophersOnPool(int nphilosophers, int nworkers);
 void *philosopherThread(void *arg);
 void thinking(int threadIndex);
 void pickUpChopsticks(int threadIndex);
@@ -18,117 +36,312 @@ void putDownChopsticks(int threadIndex);
 
 /*
  * N philosophers sitting at a round table
- * chopstick: binary semaphore per chopstick (0 = unavailable, 1 = available)
+ * table: binary semaphore per chopstick (0 = unavailable, 1 = available), see chopsticks.h
 */
 static int N;
-static sem_t chopstick[MAX_THREADS];
+static table_t table;
+
+// Per-thread rand_r() state: rand() shares one hidden state between all threads
+static __thread unsigned rng;
+
+/*
+ * Run mode
+ * - once (default): every philosopher thinks, eats and puts down once, printing each step
+ * - -m M: every philosopher eats M meals; -d S: everyone eats as often as possible for S seconds.
+ *   These runs print a summary instead of one line per step.
+ * - -e / -t: fixed eat / think time in microseconds (0 = pure contention); default random 1-500 ms
+ * - -w K: run the single meal of every philosopher as a task on K pool threads instead of one
+ *   thread per philosopher. Not with -m / -d, which need every philosopher at the table at once.
+ */
+static unsigned long meals_per_philosopher;
+static double duration;
+static long eat_us = -1, think_us = -1;
+static int repeated;
+
+// Contention counters, one per philosopher (written only by its own thread)
+typedef struct {
+    unsigned long meals;
+    unsigned long trywait_failures;
+    double wait; // seconds spent in pickUpChopsticks()
+    double max_wait;
+} philosopher_stats_t;
 
-static int left_of(int i)  { 
-    return i; 
+static philosopher_stats_t *stats;
+static pthread_barrier_t start_line;
+static _Atomic int stop;
+static double elapsed;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
 }
 
-static int right_of(int i) { 
-    return (i + 1) % N; 
+static void pause_us(long us) {
+    if (us > 0) usleep((useconds_t)us);
+}
+
+// Jain's fairness index: 1 when all values are equal, 1/n when one philosopher has everything
+static double jain_index(const double *x, int n) {
+    double sum = 0, sum_sq = 0;
+    for (int i = 0; i < n; i++) {
+        sum += x[i];
+        sum_sq += x[i] * x[i];
+    }
+    return sum_sq > 0 ? sum * sum / ((double)n * sum_sq) : 1.0;
+}
+
+static void printSummary(chop_strategy_t strategy) {
+    double *x = malloc(sizeof(double) * (size_t)N);
+    unsigned long total = 0, failures = 0, least = (unsigned long)-1, most = 0;
+    double wait = 0, max_wait = 0;
+    for (int i = 0; i < N; i++) {
+        total += stats[i].meals;
+        failures += stats[i].trywait_failures;
+        wait += stats[i].wait;
+        if (stats[i].meals < least) least = stats[i].meals;
+        if (stats[i].meals > most) most = stats[i].meals;
+        if (stats[i].max_wait > max_wait) max_wait = stats[i].max_wait;
+    }
+
+    printf("strategy:               %s\n", strategy == CHOP_BLOCKING ? "block" : "backoff");
+    printf("elapsed:                %.3f s\n", elapsed);
+    printf("meals:                  %lu (%.0f meals/s)\n", total, (double)total / elapsed);
+    printf("meals per philosopher:  min %lu, max %lu\n", least, most);
+    for (int i = 0; i < N; i++) x[i] = (double)stats[i].meals;
+    printf("Jain fairness (meals):  %.4f\n", jain_index(x, N));
+    for (int i = 0; i < N; i++) x[i] = stats[i].meals ? stats[i].wait / (double)stats[i].meals : 0.0;
+    printf("Jain fairness (wait):   %.4f\n", jain_index(x, N));
+    printf("wait per meal:          %.1f us average, %.1f us max\n", total ? wait / (double)total * 1e6 : 0.0,
+           max_wait * 1e6);
+    printf("trywait failures:       %lu\n", failures);
+    free(x);
 }
 
 int main(int argc, char **argv) {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <N_Threads>\n", argv[0]);
+    const char *usage = "Usage: %s <N_Threads> [backoff|block] [-m meals | -d seconds] [-e eat_us] [-t think_us] "
+                        "[-w pool_workers]\n";
+    if (argc < 2) {
+        fprintf(stderr, usage, argv[0]);
         return 1;
     }
 
     N = atoi(argv[1]);
-    if (N <= 1 || N > MAX_THREADS) {
-        fprintf(stderr, "Error: N must be in [2, %d]\n", MAX_THREADS);
+    if (N <= 1) {
+        fprintf(stderr, "Error: N must be at least 2\n");
         return 1;
     }
 
-    for (int i = 0; i < N; i++) {
-        if (sem_init(&chopstick[i], 0, 1) != 0) {
-            perror("sem_init");
+    chop_strategy_t strategy = CHOP_BACKOFF;
+    int nworkers = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "block") == 0) {
+            strategy = CHOP_BLOCKING;
+        } else if (strcmp(argv[i], "backoff") == 0) {
+            strategy = CHOP_BACKOFF;
+        } else if (i + 1 < argc && strcmp(argv[i], "-m") == 0) {
+            meals_per_philosopher = strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+            duration = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-e") == 0) {
+            eat_us = atol(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+            think_us = atol(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+            nworkers = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, usage, argv[0]);
             return 1;
         }
     }
-    
+    if ((meals_per_philosopher > 0 && duration > 0) || duration < 0 || eat_us < -1 || think_us < -1) {
+        fprintf(stderr, "Error: give either -m or -d, and non-negative times\n");
+        return 1;
+    }
+    repeated = meals_per_philosopher > 0 || duration > 0;
+    if (nworkers < 0 || (nworkers > 0 && repeated)) {
+        fprintf(stderr, "Error: -w takes a positive worker count and cannot be combined with -m or -d\n");
+        return 1;
+    }
+
+    if (table_init(&table, N, strategy) != 0) {
+        perror("table_init");
+        return 1;
+    }
+    if (strategy == CHOP_BLOCKING) futex_hash_reserve((unsigned)N); /* blocked philosophers sleep on their chopsticks */
+    stats = calloc((size_t)N, sizeof(philosopher_stats_t));
+    if (!stats) {
+        perror("calloc");
+        return 1;
+    }
+
     printf("%s: Assignment 4: # of threads = %d\n", NAME, N);
-    
-    createPhilosophers(N);
 
-    for (int i = 0; i < N; i++) {
-        sem_destroy(&chopstick[i]);
+    // Threads log through per-thread rings; a background thread does the printing, so the
+    // printf lock is no longer part of the contention being measured
+    if (flog_init(events, sizeof(events) / sizeof(events[0]), 0) != 0) {
+        perror("flog_init");
+        return 1;
     }
+    trace_init();
+    trace_thread_name("main", -1);
+
+    if (nworkers > 0) {
+        runPhilosophersOnPool(N, nworkers);
+    } else {
+        createPhilosophers(N);
+    }
+
+    flog_shutdown();
+    trace_export("assign4-part2.trace.json");
+
+    if (repeated) printSummary(strategy);
+
+    free(stats);
+    table_destroy(&table);
 
     return 0;
 }
 
 void createPhilosophers(int nthreads) {
-    pthread_t tids[MAX_THREADS];
-    int idx[MAX_THREADS];
+    pthread_t *tids = malloc(sizeof(pthread_t) * (size_t)nthreads);
+    int *idx = malloc(sizeof(int) * (size_t)nthreads);
+    if (!tids || !idx) {
+        perror("malloc");
+        exit(1);
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, STACK_SIZE);
+    if (repeated) pthread_barrier_init(&start_line, NULL, (unsigned)nthreads + 1);
 
     for (int i = 0; i < nthreads; i++) {
         idx[i] = i;
-        pthread_create(&tids[i], NULL, philosopherThread, &idx[i]);
+        if (trace_pthread_create(&tids[i], &attr, philosopherThread, &idx[i]) != 0) {
+            fprintf(stderr, "pthread_create failed at philosopher %d\n", i);
+            exit(1);
+        }
+    }
+
+    // Repeated runs: time the meals only, not thread creation
+    double start = 0;
+    if (repeated) {
+        pthread_barrier_wait(&start_line);
+        start = now_sec();
+        if (duration > 0) {
+            struct timespec ts = {(time_t)duration, (long)((duration - (double)(time_t)duration) * 1e9)};
+            nanosleep(&ts, NULL);
+            atomic_store(&stop, 1);
+        }
     }
 
     for (int i = 0; i < nthreads; i++) {
-        pthread_join(tids[i], NULL);
+        trace_pthread_join(tids[i], NULL);
+    }
+    if (repeated) {
+        elapsed = now_sec() - start;
+        pthread_barrier_destroy(&start_line);
+    }
+
+    flog(LOG_THREADS_DONE, nthreads);
+
+    pthread_attr_destroy(&attr);
+    free(tids);
+    free(idx);
+}
+
+static void philosopherTask(uint64_t i, void *ctx) {
+    (void)ctx;
+    int idx = (int)i;
+    philosopherThread(&idx);
+}
+
+/* Same philosophers as tasks on a fixed pool of worker threads (exercises/common/thread_pool.h).
+ * Safe with either strategy: a philosopher holds chopsticks only while its task runs, and the
+ * chopstick order guarantees some holder can always finish eating. */
+void runPhilosophersOnPool(int nphilosophers, int nworkers) {
+    tp_pool_t pool;
+    if (tp_init_stack(&pool, nworkers, 1024, STACK_SIZE) != 0) {
+        perror("tp_init");
+        exit(1);
     }
-    
-    printf("%d threads have been completed/joined successfully!\n", nthreads);
+    tp_parallel_for(&pool, (uint64_t)nphilosophers, 1, philosopherTask, NULL);
+    tp_destroy(&pool);
+
+    flog(LOG_POOL_DONE, nphilosophers, nworkers);
 }
 
 void *philosopherThread(void *arg) {
     int idx = *(int *)arg;
+    rng = (unsigned)time(NULL) ^ (unsigned)(idx * 2654435761u);
+    trace_thread_name("Philosopher", idx);
+
+    if (!repeated) {
+        thinking(idx);
+        pickUpChopsticks(idx);
+        eating(idx);
+        putDownChopsticks(idx);
+        return NULL;
+    }
 
-    thinking(idx);
-    pickUpChopsticks(idx); 
-    eating(idx);
-    putDownChopsticks(idx);
+    pthread_barrier_wait(&start_line);
+    for (unsigned long m = 0; duration > 0 ? !atomic_load_explicit(&stop, memory_order_relaxed)
+                                           : m < meals_per_philosopher; m++) {
+        thinking(idx);
+        pickUpChopsticks(idx);
+        eating(idx);
+        putDownChopsticks(idx);
+    }
 
     return NULL;
 }
 
 void thinking(int threadIndex) {
-    useconds_t t = (useconds_t)((rand() % 500) + 1) * 1000;
-    printf("Philosopher %d: thinking\n", threadIndex);
-    usleep(t);
+    uint64_t start = trace_now();
+    if (think_us >= 0) {
+        pause_us(think_us);
+    } else {
+        useconds_t t = (useconds_t)((rand_r(&rng) % 500) + 1) * 1000;
+        if (!repeated) flog(LOG_THINKING, threadIndex);
+        usleep(t);
+    }
+    trace_span("think", "philosopher", threadIndex, start);
 }
 
-/* Asymmetric Solution + "only if both available"
+/* Asymmetric Solution
  * - Even-numbered philosophers: pick up left first, then right
  * - Odd-numbered philosophers:  pick up right first, then left
- * - Use sem_trywait on both. If the second isn’t available, release the first immediately.
- * - No one holds one chopstick while waiting for the other (deadlock avoided).
+ * - backoff: sem_trywait on both. If the second isn’t available, release the first immediately
+ *   and retry after 1-3 ms, so no one holds one chopstick while waiting for the other.
+ * - block: sem_wait on both in that order. The ordering alone rules out deadlock, and a
+ *   waiting philosopher is woken as soon as the chopstick is put down.
  */
 void pickUpChopsticks(int threadIndex) {
-    int L = left_of(threadIndex);
-    int R = right_of(threadIndex);
-
-    while (1) {
-        int first  = (threadIndex % 2 == 0) ? L : R;
-        int second = (threadIndex % 2 == 0) ? R : L;
-
-        if (sem_trywait(&chopstick[first]) == 0) {
-            if (sem_trywait(&chopstick[second]) == 0) {
-                return;
-            }
-            sem_post(&chopstick[first]);
-        }
-
-        usleep((useconds_t)((rand() % 3) + 1) * 1000);
-    }
+    philosopher_stats_t *s = &stats[threadIndex];
+    uint64_t start = trace_now();
+    double t0 = now_sec();
+    s->trywait_failures += table_pick_up(&table, threadIndex, &rng);
+    double waited = now_sec() - t0;
+    trace_span("pick up", "philosopher", threadIndex, start);
+    s->wait += waited;
+    if (waited > s->max_wait) s->max_wait = waited;
 }
 
 void eating(int threadIndex) {
-    printf("Philosopher %d: starts eating\n", threadIndex);
-    useconds_t t = (useconds_t)((rand() % 500) + 1) * 1000;  // 1–500 ms
-    usleep(t);
-    printf("Philosopher %d: ends eating\n", threadIndex);
+    uint64_t start = trace_now();
+    stats[threadIndex].meals++;
+    if (eat_us >= 0) {
+        pause_us(eat_us);
+    } else {
+        if (!repeated) flog(LOG_STARTS_EATING, threadIndex);
+        useconds_t t = (useconds_t)((rand_r(&rng) % 500) + 1) * 1000;  // 1–500 ms
+        usleep(t);
+        if (!repeated) flog(LOG_ENDS_EATING, threadIndex);
+    }
+    trace_span("eat", "philosopher", threadIndex, start);
 }
 
 void putDownChopsticks(int threadIndex) {
-    int L = left_of(threadIndex);
-    int R = right_of(threadIndex);
-    sem_post(&chopstick[L]);
-    sem_post(&chopstick[R]);
-}
\ No newline at end of file
+    table_put_down(&table, threadIndex);
+}
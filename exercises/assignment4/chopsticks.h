@@ -0,0 +1,97 @@
+#ifndef CHOPSTICKS_H
+#define CHOPSTICKS_H
+
+/*
+ * The chopsticks of a round table of N philosophers, with two ways of picking them up.
+ *
+ * Both keep the asymmetric order of the original solution: even-numbered philosophers take
+ * their left chopstick first, odd-numbered ones their right. Since not everyone reaches for the
+ * same side first, no cycle of philosophers each holding one chopstick can form.
+ *
+ *   CHOP_BACKOFF   sem_trywait both. If the second is taken, put the first back and sleep
+ *                  1-3 ms before trying again (the original assignment code)
+ *   CHOP_BLOCKING  sem_wait both in that order. A philosopher whose chopstick is taken sleeps
+ *                  in the kernel until its holder posts it, and wakes up immediately
+ *
+ * Holding the first chopstick while blocking on the second is safe only because of the
+ * ordering; the backoff version releases it because it never blocks at all.
+ */
+
+#include <semaphore.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "trace.h" /* exercises/common: sem_* calls are recorded when built with -DTRACE */
+
+typedef enum { CHOP_BACKOFF, CHOP_BLOCKING } chop_strategy_t;
+
+typedef struct {
+    int n;
+    chop_strategy_t strategy;
+    sem_t *sticks; /* 1 = on the table, 0 = in use */
+} table_t;
+
+/* Returns 0 on success, -1 if the chopsticks cannot be allocated */
+static inline int table_init(table_t *t, int n, chop_strategy_t strategy) {
+    t->n = n;
+    t->strategy = strategy;
+    t->sticks = (sem_t *)malloc(sizeof(sem_t) * (size_t)n);
+    if (!t->sticks) return -1;
+    for (int i = 0; i < n; i++) {
+        if (sem_init(&t->sticks[i], 0, 1) != 0) return -1;
+    }
+    return 0;
+}
+
+static inline void table_destroy(table_t *t) {
+    for (int i = 0; i < t->n; i++) {
+        sem_destroy(&t->sticks[i]);
+    }
+    free(t->sticks);
+    t->sticks = NULL;
+}
+
+static inline int table_left(const table_t *t, int i) {
+    (void)t;
+    return i;
+}
+
+static inline int table_right(const table_t *t, int i) {
+    return (i + 1) % t->n;
+}
+
+/* Take both chopsticks of philosopher i. rng is the caller's rand_r() state (rand() is not
+ * thread-safe). Returns how many sem_trywait calls failed on the way (always 0 when blocking). */
+static inline unsigned table_pick_up(table_t *t, int i, unsigned *rng) {
+    int L = table_left(t, i);
+    int R = table_right(t, i);
+    int first = (i % 2 == 0) ? L : R;
+    int second = (i % 2 == 0) ? R : L;
+
+    if (t->strategy == CHOP_BLOCKING) {
+        while (trace_sem_wait(&t->sticks[first], "chopstick", first) != 0) {
+            /* EINTR: try again */
+        }
+        while (trace_sem_wait(&t->sticks[second], "chopstick", second) != 0) {
+        }
+        return 0;
+    }
+
+    unsigned failures = 0;
+    while (1) {
+        if (trace_sem_trywait(&t->sticks[first], "chopstick", first) == 0) {
+            if (trace_sem_trywait(&t->sticks[second], "chopstick", second) == 0) {
+                return failures;
+            }
+            trace_sem_post(&t->sticks[first], "chopstick", first);
+        }
+        failures++;
+        usleep((useconds_t)((rand_r(rng) % 3) + 1) * 1000);
+    }
+}
+
+static inline void table_put_down(table_t *t, int i) {
+    trace_sem_post(&t->sticks[table_left(t, i)], "chopstick", table_left(t, i));
+    trace_sem_post(&t->sticks[table_right(t, i)], "chopstick", table_right(t, i));
+}
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Meals per second and per-philosopher fairness for the two ways of picking up chopsticks in
+ * chopsticks.h. Every meal and every thought is a sleep of eat_us / think_us microseconds, like
+ * the usleep() in assign4-part2.c, so neighbors really contend for the chopsticks whatever the
+ * number of CPUs. With eat_us = 0 a thread on a single CPU is almost never preempted while
+ * holding its chopsticks, and the run measures mostly the scheduler.
+ *
+ *   ./philo_bench [max_philosophers] [seconds] [eat_us] [think_us]    (default 100000 2 100 100)
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "chopsticks.h"
+#include "futex_hash.h"
+
+#define STACK_SIZE (64 * 1024)
+
+typedef struct {
+    int id;
+    unsigned rng;
+    unsigned long meals;
+    unsigned long failures; /* failed sem_trywait calls */
+    double wait; /* seconds spent picking up chopsticks */
+    double max_wait;
+} philosopher_t;
+
+static table_t table;
+static philosopher_t *phil;
+static pthread_barrier_t start_line;
+static _Atomic int stop;
+static long eat_us = 100, think_us = 100;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void pause_us(long us) {
+    if (us <= 0) return;
+    struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+    nanosleep(&ts, NULL);
+}
+
+static void *philosopher(void *arg) {
+    philosopher_t *p = (philosopher_t *)arg;
+    pthread_barrier_wait(&start_line);
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        double t0 = now_sec();
+        p->failures += table_pick_up(&table, p->id, &p->rng);
+        double waited = now_sec() - t0;
+        p->wait += waited;
+        if (waited > p->max_wait) p->max_wait = waited;
+        p->meals++;
+        pause_us(eat_us);
+        table_put_down(&table, p->id);
+        pause_us(think_us);
+    }
+    return NULL;
+}
+
+/* One run; returns 0 on success, -1 if the table cannot be set up */
+static int run(int n, chop_strategy_t strategy, double seconds) {
+    if (table_init(&table, n, strategy) != 0) {
+        perror("table_init");
+        return -1;
+    }
+    phil = calloc((size_t)n, sizeof(philosopher_t));
+    pthread_t *tid = malloc(sizeof(pthread_t) * (size_t)n);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, STACK_SIZE);
+    pthread_barrier_init(&start_line, NULL, (unsigned)n + 1);
+    atomic_store(&stop, 0);
+
+    for (int i = 0; i < n; i++) {
+        phil[i].id = i;
+        phil[i].rng = 0x9E3779B9u * (unsigned)(i + 1);
+        if (pthread_create(&tid[i], &attr, philosopher, &phil[i]) != 0) {
+            fprintf(stderr, "pthread_create failed at philosopher %d (raise ulimit -u / kernel.threads-max)\n", i);
+            exit(1);
+        }
+    }
+
+    /* Time only the meals, not thread creation */
+    pthread_barrier_wait(&start_line);
+    double start = now_sec();
+    struct timespec ts = {(time_t)seconds, (long)((seconds - (double)(time_t)seconds) * 1e9)};
+    nanosleep(&ts, NULL);
+    atomic_store(&stop, 1);
+    for (int i = 0; i < n; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    double elapsed = now_sec() - start;
+
+    unsigned long total = 0, failures = 0, least = (unsigned long)-1, most = 0;
+    double wait = 0, max_wait = 0;
+    for (int i = 0; i < n; i++) {
+        total += phil[i].meals;
+        failures += phil[i].failures;
+        wait += phil[i].wait;
+        if (phil[i].meals < least) least = phil[i].meals;
+        if (phil[i].meals > most) most = phil[i].meals;
+        if (phil[i].max_wait > max_wait) max_wait = phil[i].max_wait;
+    }
+    printf("%8d %8s %12.0f %10lu %10lu %12.1f %12.1f %12lu\n", n, strategy == CHOP_BLOCKING ? "block" : "backoff",
+           (double)total / elapsed, least, most, total ? wait / (double)total * 1e6 : 0.0, max_wait * 1e6, failures);
+    fflush(stdout);
+
+    pthread_barrier_destroy(&start_line);
+    pthread_attr_destroy(&attr);
+    free(tid);
+    free(phil);
+    table_destroy(&table);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int max_n = (argc > 1) ? atoi(argv[1]) : 100000;
+    double seconds = (argc > 2) ? atof(argv[2]) : 2.0;
+    if (argc > 3) eat_us = atol(argv[3]);
+    if (argc > 4) think_us = atol(argv[4]);
+    static const int sizes[] = {5, 100, 1000, 10000, 100000};
+    if (max_n < 5 || seconds <= 0 || eat_us < 0 || think_us < 0) {
+        fprintf(stderr, "Usage: %s [max_philosophers >= 5] [seconds] [eat_us] [think_us]\n", argv[0]);
+        return 1;
+    }
+
+    /* Blocked philosophers sleep on their chopsticks' futexes */
+    futex_hash_reserve((unsigned)max_n);
+
+    printf("%.1f s per run, eat %ld us, think %ld us\n", seconds, eat_us, think_us);
+    printf("%8s %8s %12s %10s %10s %12s %12s %12s\n", "phils", "strategy", "meals/s", "min meals", "max meals",
+           "avg wait us", "max wait us", "trywait fail");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && sizes[i] <= max_n; i++) {
+        if (run(sizes[i], CHOP_BLOCKING, seconds) != 0) return 1;
+        if (run(sizes[i], CHOP_BACKOFF, seconds) != 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+#ifndef FASTLOG_H
+#define FASTLOG_H
+
+/*
+ * Low-overhead logging for the threaded exercises. printf() from many threads serializes them
+ * all on the lock inside stdout, so the output itself becomes the contention being measured.
+ *
+ *   static const char *events[] = {"Customer %ld arrives.\n", ...};
+ *   flog_init(events, n_events, 0);    // 0: default ring size
+ *   flog(EV_ARRIVE, id + 1);           // any thread, up to 3 integer arguments
+ *   flog_shutdown();                   // prints what is left, joins the flusher
+ *
+ * Every thread gets its own single-producer ring of fixed-size binary records (timestamp,
+ * thread number, event number, arguments), allocated on its first flog(). Writing a record takes
+ * no lock and makes no system call: fill the next slot, then publish it with one release store.
+ * A background thread collects the records of all rings, sorts them by timestamp and formats
+ * them with the event's printf format in batches, so stdout is only touched from one thread.
+ * Formats take their arguments as long (%ld).
+ *
+ * If the environment variable FLOG_TRACE names a file, the flusher writes the raw records there
+ * instead of formatting them (header: the format strings). flog_replay prints such a file with
+ * timestamps and thread numbers.
+ *
+ * A thread whose ring is full wakes the flusher and yields until there is room, so no record is
+ * lost. Records reach the output in timestamp order, except for a thread preempted between
+ * taking its timestamp and publishing the record.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define FLOG_DEFAULT_CAPACITY 64 /* records per thread; small, since there may be 100k threads */
+#define FLOG_INTERVAL_NS 1000000 /* the flusher looks at the rings at least every 1 ms */
+#define FLOG_MAGIC "FLOGv1\n"
+
+typedef struct {
+    uint64_t ts;   /* CLOCK_MONOTONIC, nanoseconds */
+    uint32_t tid;  /* threads are numbered 1, 2, ... in the order of their first record */
+    uint16_t event;
+    uint16_t seq;  /* low bits of the thread's record count: orders records with equal timestamps */
+    int64_t args[3];
+} flog_record_t;
+
+typedef struct flog_ring {
+    _Atomic uint64_t head __attribute__((aligned(64))); /* written by the owning thread */
+    _Atomic uint64_t tail __attribute__((aligned(64))); /* written by the flusher */
+    _Atomic int closed; /* the owning thread has exited */
+    uint32_t tid;
+    uint64_t mask;
+    struct flog_ring *next;
+    flog_record_t recs[];
+} flog_ring_t;
+
+static struct {
+    const char *const *formats;
+    int nformats;
+    uint64_t capacity;
+    _Atomic(flog_ring_t *) rings; /* new rings are pushed here; only the flusher unlinks */
+    _Atomic uint32_t next_tid;
+    _Atomic unsigned wake; /* futex word the flusher sleeps on */
+    _Atomic int stop;
+    _Atomic uint64_t stalls; /* flog() calls that found their ring full */
+    pthread_key_t key;
+    pthread_t flusher;
+    FILE *trace; /* binary records go here when FLOG_TRACE is set */
+    flog_record_t *batch;
+    size_t batch_cap;
+} flog_g;
+
+static __thread flog_ring_t *flog_self;
+
+static inline uint64_t flog_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline void flog_wake_flusher(void) {
+    atomic_fetch_add_explicit(&flog_g.wake, 1, memory_order_release);
+    syscall(SYS_futex, (unsigned *)&flog_g.wake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+/* Thread exit: the flusher frees the ring once it has printed the rest of it */
+static void flog_thread_exit(void *ring) {
+    atomic_store_explicit(&((flog_ring_t *)ring)->closed, 1, memory_order_release);
+}
+
+static flog_ring_t *flog_register(void) {
+    flog_ring_t *r = (flog_ring_t *)calloc(1, sizeof(flog_ring_t) + sizeof(flog_record_t) * flog_g.capacity);
+    if (!r) {
+        perror("flog");
+        exit(1);
+    }
+    r->mask = flog_g.capacity - 1;
+    r->tid = atomic_fetch_add_explicit(&flog_g.next_tid, 1, memory_order_relaxed) + 1;
+    r->next = atomic_load_explicit(&flog_g.rings, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&flog_g.rings, &r->next, r, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    pthread_setspecific(flog_g.key, r);
+    flog_self = r;
+    return r;
+}
+
+static inline void flog_write(int event, long a0, long a1, long a2) {
+    flog_ring_t *r = flog_self ? flog_self : flog_register();
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&r->tail, memory_order_acquire) > r->mask) {
+        atomic_fetch_add_explicit(&flog_g.stalls, 1, memory_order_relaxed);
+        do {
+            flog_wake_flusher();
+            sched_yield();
+        } while (head - atomic_load_explicit(&r->tail, memory_order_acquire) > r->mask);
+    }
+    flog_record_t *rec = &r->recs[head & r->mask];
+    rec->tid = r->tid;
+    rec->event = (uint16_t)event;
+    rec->seq = (uint16_t)head;
+    rec->args[0] = a0;
+    rec->args[1] = a1;
+    rec->args[2] = a2;
+    rec->ts = flog_now();
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+#define FLOG_ARGS_(event, a0, a1, a2, ...) (event), (long)(a0), (long)(a1), (long)(a2)
+#define flog(...) flog_write(FLOG_ARGS_(__VA_ARGS__, 0, 0, 0, 0))
+
+static int flog_cmp(const void *a, const void *b) {
+    const flog_record_t *x = (const flog_record_t *)a, *y = (const flog_record_t *)b;
+    if (x->ts != y->ts) return x->ts < y->ts ? -1 : 1;
+    if (x->tid != y->tid) return x->tid < y->tid ? -1 : 1;
+    return (int16_t)(x->seq - y->seq);
+}
+
+/* Print (or write out) every record stamped before `until`; returns how many there were */
+static size_t flog_drain(uint64_t until) {
+    size_t n = 0;
+    flog_ring_t *prev = NULL;
+    flog_ring_t *r = atomic_load_explicit(&flog_g.rings, memory_order_acquire);
+    while (r) {
+        int closed = atomic_load_explicit(&r->closed, memory_order_acquire);
+        uint64_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+        for (; tail != head && r->recs[tail & r->mask].ts < until; tail++) {
+            if (n == flog_g.batch_cap) {
+                flog_g.batch_cap = flog_g.batch_cap ? flog_g.batch_cap * 2 : 4096;
+                flog_g.batch = (flog_record_t *)realloc(flog_g.batch, sizeof(flog_record_t) * flog_g.batch_cap);
+                if (!flog_g.batch) {
+                    perror("flog");
+                    exit(1);
+                }
+            }
+            flog_g.batch[n++] = r->recs[tail & r->mask];
+        }
+        atomic_store_explicit(&r->tail, tail, memory_order_release);
+
+        flog_ring_t *next = r->next;
+        /* The list head may be replaced by a concurrent push at any time, so a closed ring is
+         * unlinked only from behind another ring; the head one waits for flog_shutdown() */
+        if (closed && tail == head && prev) {
+            prev->next = next;
+            free(r);
+        } else {
+            prev = r;
+        }
+        r = next;
+    }
+    if (n == 0) return 0;
+
+    qsort(flog_g.batch, n, sizeof(flog_record_t), flog_cmp);
+    if (flog_g.trace) {
+        fwrite(flog_g.batch, sizeof(flog_record_t), n, flog_g.trace);
+        return n;
+    }
+    for (size_t i = 0; i < n; i++) {
+        const flog_record_t *rec = &flog_g.batch[i];
+        if (rec->event < flog_g.nformats) {
+            printf(flog_g.formats[rec->event], (long)rec->args[0], (long)rec->args[1], (long)rec->args[2]);
+        }
+    }
+    fflush(stdout);
+    return n;
+}
+
+static void *flog_flusher_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        unsigned seen = atomic_load_explicit(&flog_g.wake, memory_order_acquire);
+        int stop = atomic_load_explicit(&flog_g.stop, memory_order_acquire);
+        /* Records stamped after this drain starts are left for the next one, so a record
+         * published late by a slower ring still sorts ahead of newer ones */
+        flog_drain(stop ? UINT64_MAX : flog_now());
+        if (stop) break;
+        struct timespec timeout = {0, FLOG_INTERVAL_NS};
+        syscall(SYS_futex, (unsigned *)&flog_g.wake, FUTEX_WAIT_PRIVATE, seen, &timeout, NULL, 0);
+    }
+    return NULL;
+}
+
+/* formats[e] is the printf format of event e. capacity: records per thread, rounded up to a
+ * power of two (0 = FLOG_DEFAULT_CAPACITY). Returns 0, or -1 if the trace file or the flusher
+ * thread cannot be created. */
+static inline int flog_init(const char *const *formats, int nformats, uint64_t capacity) {
+    uint64_t cap = 2;
+    if (capacity == 0) capacity = FLOG_DEFAULT_CAPACITY;
+    while (cap < capacity) cap <<= 1;
+    memset(&flog_g, 0, sizeof(flog_g));
+    flog_g.formats = formats;
+    flog_g.nformats = nformats;
+    flog_g.capacity = cap;
+    if (pthread_key_create(&flog_g.key, flog_thread_exit) != 0) return -1;
+
+    const char *path = getenv("FLOG_TRACE");
+    if (path && *path) {
+        flog_g.trace = fopen(path, "wb");
+        if (!flog_g.trace) return -1;
+        uint32_t count = (uint32_t)nformats;
+        fwrite(FLOG_MAGIC, 1, 8, flog_g.trace);
+        fwrite(&count, sizeof(count), 1, flog_g.trace);
+        for (int i = 0; i < nformats; i++) {
+            uint32_t len = (uint32_t)strlen(formats[i]);
+            fwrite(&len, sizeof(len), 1, flog_g.trace);
+            fwrite(formats[i], 1, len, flog_g.trace);
+        }
+    }
+
+    fflush(stdout); /* whatever main printed before comes first */
+    return pthread_create(&flog_g.flusher, NULL, flog_flusher_main, NULL) == 0 ? 0 : -1;
+}
+
+/* Call once every logging thread is done: writes out the remaining records and frees the rings */
+static inline void flog_shutdown(void) {
+    atomic_store_explicit(&flog_g.stop, 1, memory_order_release);
+    flog_wake_flusher();
+    pthread_join(flog_g.flusher, NULL);
+
+    flog_ring_t *r = atomic_load_explicit(&flog_g.rings, memory_order_acquire);
+    while (r) {
+        flog_ring_t *next = r->next;
+        free(r);
+        r = next;
+    }
+    flog_self = NULL;
+    pthread_setspecific(flog_g.key, NULL);
+    pthread_key_delete(flog_g.key);
+    if (flog_g.trace) fclose(flog_g.trace);
+    free(flog_g.batch);
+    memset(&flog_g, 0, sizeof(flog_g));
+}
+
+#endif
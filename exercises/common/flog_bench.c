@@ -0,0 +1,98 @@
+/*
+ * Cost of one log line on the logging thread: printf() versus fastlog.h, with T threads logging
+ * at once. stdout goes to /dev/null, so only the formatting, the locking and the writes count.
+ *
+ *   ./flog_bench [lines_per_thread] [max_threads]    (default 200000 lines, up to 8 threads)
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "fastlog.h"
+
+enum { EV_LINE };
+static const char *events[] = {"Philosopher %ld: meal %ld, chopsticks %ld\n"};
+
+#define RING 65536 /* records per thread: the flusher keeps up, so logging threads never wait */
+
+static long lines;
+static int use_flog;
+static pthread_barrier_t start_line;
+static uint64_t stalls;
+static double busy[64]; /* CPU seconds each thread spent logging */
+
+static double now_sec(void) {
+    return (double)flog_now() / 1e9;
+}
+
+/* CPU time of the calling thread: on a busy machine, wall time would include other threads */
+static double thread_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *logger(void *arg) {
+    int id = (int)(intptr_t)arg;
+    pthread_barrier_wait(&start_line);
+    double start = thread_sec();
+    for (long i = 0; i < lines; i++) {
+        if (use_flog) {
+            flog(EV_LINE, id, i, 2);
+        } else {
+            printf(events[EV_LINE], (long)id, i, 2L);
+        }
+    }
+    busy[id] = thread_sec() - start;
+    return NULL;
+}
+
+/* Returns the average CPU time per line on the logging threads, in ns; *total: wall time until
+ * everything is written, including the flusher's formatting */
+static double run(int threads, int flog_mode, double *total) {
+    pthread_t tid[64];
+    use_flog = flog_mode;
+    if (use_flog && flog_init(events, 1, RING) != 0) {
+        perror("flog_init");
+        exit(1);
+    }
+    pthread_barrier_init(&start_line, NULL, (unsigned)threads);
+    double start = now_sec();
+    for (int i = 0; i < threads; i++) pthread_create(&tid[i], NULL, logger, (void *)(intptr_t)i);
+    for (int i = 0; i < threads; i++) pthread_join(tid[i], NULL);
+    if (use_flog) {
+        stalls = atomic_load(&flog_g.stalls);
+        flog_shutdown();
+    }
+    fflush(stdout);
+    *total = now_sec() - start;
+    pthread_barrier_destroy(&start_line);
+
+    double sum = 0;
+    for (int i = 0; i < threads; i++) sum += busy[i];
+    return sum / (double)threads / (double)lines * 1e9;
+}
+
+int main(int argc, char **argv) {
+    lines = (argc > 1) ? atol(argv[1]) : 200000;
+    int max_threads = (argc > 2) ? atoi(argv[2]) : 8;
+    if (lines < 1 || max_threads < 1 || max_threads > 64) {
+        fprintf(stderr, "Usage: %s [lines_per_thread] [max_threads <= 64]\n", argv[0]);
+        return 1;
+    }
+    if (!freopen("/dev/null", "w", stdout)) {
+        perror("/dev/null");
+        return 1;
+    }
+
+    fprintf(stderr, "%8s %16s %16s %14s %14s %8s\n", "threads", "printf ns/line", "flog ns/line", "printf total",
+            "flog total", "stalls");
+    for (int t = 1; t <= max_threads; t *= 2) {
+        double printf_total, flog_total;
+        double p = run(t, 0, &printf_total);
+        double f = run(t, 1, &flog_total);
+        fprintf(stderr, "%8d %16.1f %16.1f %12.3f s %12.3f s %8llu\n", t, p, f, printf_total, flog_total,
+                (unsigned long long)stalls);
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Prints a binary trace written by fastlog.h (run the program with FLOG_TRACE=<file>): every
+ * record with its time since the first record and the number of the thread that logged it.
+ *
+ *   ./flog_replay <trace> [-r]    (-r: the messages only, exactly as the program would print them)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fastlog.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2 || (argc == 3 && strcmp(argv[2], "-r") != 0) || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace> [-r]\n", argv[0]);
+        return 1;
+    }
+    int raw = argc == 3;
+
+    FILE *f = fopen(argv[1], "rb");
+    if (!f) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    char magic[8];
+    uint32_t nformats;
+    if (fread(magic, 1, 8, f) != 8 || memcmp(magic, FLOG_MAGIC, 8) != 0 || fread(&nformats, sizeof(nformats), 1, f) != 1) {
+        fprintf(stderr, "%s: not a fastlog trace\n", argv[1]);
+        return 1;
+    }
+    char **formats = calloc(nformats, sizeof(char *));
+    for (uint32_t i = 0; i < nformats; i++) {
+        uint32_t len;
+        if (fread(&len, sizeof(len), 1, f) != 1 || !(formats[i] = malloc(len + 1)) ||
+            fread(formats[i], 1, len, f) != len) {
+            fprintf(stderr, "%s: truncated header\n", argv[1]);
+            return 1;
+        }
+        formats[i][len] = '\0';
+    }
+
+    flog_record_t rec;
+    uint64_t first = 0, count = 0;
+    while (fread(&rec, sizeof(rec), 1, f) == 1) {
+        if (count++ == 0) first = rec.ts;
+        if (!raw) printf("%12.6f  T%-6u ", (double)(rec.ts - first) / 1e9, rec.tid);
+        if (rec.event < nformats) {
+            printf(formats[rec.event], (long)rec.args[0], (long)rec.args[1], (long)rec.args[2]);
+        } else {
+            printf("unknown event %u\n", rec.event);
+        }
+    }
+    if (!raw) fprintf(stderr, "%llu records\n", (unsigned long long)count);
+
+    for (uint32_t i = 0; i < nformats; i++) free(formats[i]);
+    free(formats);
+    fclose(f);
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef FUTEX_HASH_H
+#define FUTEX_HASH_H
+
+/*
+ * Sizing the kernel's futex hash for programs that block many threads at once.
+ *
+ * Since Linux 6.16 each process gets a private futex hash sized by its CPU count (16 buckets on
+ * one CPU). Every sem_wait()/sem_post() that sleeps or wakes, and every raw FUTEX_WAIT/WAKE,
+ * walks the chain of the bucket its address hashes to. With thousands of sleepers in 16
+ * buckets, those chains get long. futex_hash_reserve(n) grows the hash to about one bucket per
+ * sleeper.
+ *
+ * The hash belongs to the whole process, so call this from main(), once, with the most
+ * threads the program will block at the same time. Older kernels reject the prctl, which is
+ * harmless.
+ */
+
+#include <sys/prctl.h>
+
+#ifndef PR_FUTEX_HASH /* Linux 6.16+ */
+# define PR_FUTEX_HASH 78
+# define PR_FUTEX_HASH_SET_SLOTS 1
+# define PR_FUTEX_HASH_GET_SLOTS 2
+#endif
+
+#define FUTEX_HASH_MAX_BUCKETS 65536
+
+static inline void futex_hash_reserve(unsigned sleepers) {
+    /* -1: old kernel. 0: no private hash yet, because the kernel makes one only when the
+     * process starts its second thread. Setting the size now makes it that big from the start. */
+    int buckets = prctl(PR_FUTEX_HASH, PR_FUTEX_HASH_GET_SLOTS, 0, 0, 0);
+    if (buckets < 0 || (unsigned)buckets >= sleepers) return;
+    unsigned want = 16;
+    while (want < sleepers && want < FUTEX_HASH_MAX_BUCKETS) want <<= 1;
+    prctl(PR_FUTEX_HASH, PR_FUTEX_HASH_SET_SLOTS, want, 0, 0);
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Tasks per second for short tasks: one pthread_create()/pthread_join() per task (how the
+ * assignment programs started their philosophers and factorials) versus thread_pool.h.
+ *
+ *   ./pool_bench [tasks] [workers]    (default 200000 tasks, one worker per CPU)
+ */
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+#define BATCH 100 /* thread-per-task: create at most this many threads before joining them */
+
+static uint64_t results[BATCH];
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* The task: 20! in 64 bits, about as much work as one factorial in assignment2/task2 */
+static uint64_t factorial20(uint64_t seed) {
+    uint64_t f = 1;
+    for (uint64_t i = 1; i <= 20; i++) f *= i + (seed & 1);
+    return f;
+}
+
+static void *task(void *arg) {
+    uint64_t *out = (uint64_t *)arg;
+    *out = factorial20((uint64_t)(out - results));
+    return out;
+}
+
+static void body(uint64_t i, void *ctx) {
+    uint64_t *sum = (uint64_t *)ctx;
+    __atomic_fetch_add(sum, factorial20(i) & 1, __ATOMIC_RELAXED);
+}
+
+static double thread_per_task(long n) {
+    pthread_t tid[BATCH];
+    double start = now_sec();
+    for (long done = 0; done < n; done += BATCH) {
+        int batch = n - done < BATCH ? (int)(n - done) : BATCH;
+        for (int i = 0; i < batch; i++) pthread_create(&tid[i], NULL, task, &results[i]);
+        for (int i = 0; i < batch; i++) pthread_join(tid[i], NULL);
+    }
+    return (double)n / (now_sec() - start);
+}
+
+static double pool_futures(tp_pool_t *pool, long n) {
+    tp_future_t *f[BATCH];
+    double start = now_sec();
+    for (long done = 0; done < n; done += BATCH) {
+        int batch = n - done < BATCH ? (int)(n - done) : BATCH;
+        for (int i = 0; i < batch; i++) f[i] = tp_submit(pool, task, &results[i]);
+        for (int i = 0; i < batch; i++) tp_await(pool, f[i]);
+    }
+    return (double)n / (now_sec() - start);
+}
+
+static double pool_parallel_for(tp_pool_t *pool, long n, uint64_t grain) {
+    uint64_t sum = 0;
+    double start = now_sec();
+    tp_parallel_for(pool, (uint64_t)n, grain, body, &sum);
+    return (double)n / (now_sec() - start);
+}
+
+int main(int argc, char **argv) {
+    long n = (argc > 1) ? atol(argv[1]) : 200000;
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = (argc > 2) ? atoi(argv[2]) : (int)ncpu;
+    if (n < 1 || workers < 1) {
+        fprintf(stderr, "Usage: %s [tasks] [workers]\n", argv[0]);
+        return 1;
+    }
+
+    tp_pool_t pool;
+    if (tp_init(&pool, workers, 1024) != 0) {
+        perror("tp_init");
+        return 1;
+    }
+
+    printf("%ld tasks, %d pool workers, %ld CPUs\n", n, workers, ncpu);
+    double t = thread_per_task(n);
+    double f = pool_futures(&pool, n);
+    double p1 = pool_parallel_for(&pool, n, 1);
+    double p64 = pool_parallel_for(&pool, n, 64);
+    printf("%-28s %14.0f tasks/s\n", "pthread_create per task", t);
+    printf("%-28s %14.0f tasks/s %8.1fx\n", "pool submit + await", f, f / t);
+    printf("%-28s %14.0f tasks/s %8.1fx\n", "pool parallel_for grain 1", p1, p1 / t);
+    printf("%-28s %14.0f tasks/s %8.1fx\n", "pool parallel_for grain 64", p64, p64 / t);
+
+    tp_destroy(&pool);
+    return 0;
+}
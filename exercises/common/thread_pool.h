@@ -0,0 +1,307 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/*
+ * Fixed-size worker pool shared by the exercises: create K threads once and run any number of
+ * short tasks on them, instead of one pthread_create()/pthread_join() per task.
+ *
+ *   tp_pool_t pool;
+ *   tp_init(&pool, K, 1024);
+ *   tp_future_t *f = tp_submit(&pool, fn, arg);   // runs fn(arg) on some worker
+ *   void *result = tp_await(&pool, f);            // waits for it and frees the future
+ *   tp_parallel_for(&pool, n, grain, body, ctx);  // body(i, ctx) for every i in [0, n)
+ *   tp_destroy(&pool);                            // finishes queued tasks, joins the workers
+ *
+ * Submission queue: a bounded lock-free multi-producer/multi-consumer ring (one sequence number
+ * per cell, as in assignment3/task2/mpsc_ring.h). Submitters and workers each claim a position
+ * with one CAS, and nobody holds a lock while a task is copied in or out.
+ *
+ * Sleeping: idle workers sleep on one futex word, and a submitter makes the wake-up system call
+ * only when some worker is actually asleep. tp_await() runs queued tasks while it waits, so a
+ * task may submit and await subtasks without using up the pool. When the ring is full,
+ * tp_submit() runs a queued task itself rather than spinning.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+typedef void *(*tp_fn_t)(void *arg);
+
+typedef struct tp_future {
+    tp_fn_t fn;
+    void *arg;
+    void *result;
+    _Atomic unsigned state; /* futex word: TP_PENDING, TP_WAITED (someone sleeps on it) or TP_DONE */
+} tp_future_t;
+
+enum { TP_PENDING, TP_DONE, TP_WAITED };
+
+typedef struct {
+    _Atomic uint64_t seq;
+    tp_future_t *task;
+} tp_cell_t;
+
+typedef struct {
+    _Atomic uint64_t tail __attribute__((aligned(64))); /* next position to fill */
+    _Atomic uint64_t head __attribute__((aligned(64))); /* next position to take */
+    _Atomic unsigned wake_seq __attribute__((aligned(64))); /* futex word idle workers sleep on */
+    _Atomic int sleepers;
+    _Atomic int shutdown;
+    uint64_t mask; /* capacity - 1, capacity a power of two */
+    tp_cell_t *cells;
+    int nworkers;
+    pthread_t *workers;
+    int spin; /* polls before sleeping; 0 on a single CPU */
+} tp_pool_t;
+
+static inline void tp_futex_wait(_Atomic unsigned *word, unsigned expected) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static inline void tp_futex_wake(_Atomic unsigned *word, int n) {
+    syscall(SYS_futex, (unsigned *)word, FUTEX_WAKE_PRIVATE, n, NULL, NULL, 0);
+}
+
+/* Append a task; returns 0 if the ring is full */
+static inline int tp_try_push(tp_pool_t *p, tp_future_t *task) {
+    uint64_t pos = atomic_load_explicit(&p->tail, memory_order_relaxed);
+    for (;;) {
+        tp_cell_t *cell = &p->cells[pos & p->mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&p->tail, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                cell->task = task;
+                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&p->tail, memory_order_relaxed);
+        }
+    }
+}
+
+/* Take the oldest task; returns NULL if the ring is empty */
+static inline tp_future_t *tp_try_pop(tp_pool_t *p) {
+    uint64_t pos = atomic_load_explicit(&p->head, memory_order_relaxed);
+    for (;;) {
+        tp_cell_t *cell = &p->cells[pos & p->mask];
+        uint64_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+        int64_t diff = (int64_t)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&p->head, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                tp_future_t *task = cell->task;
+                atomic_store_explicit(&cell->seq, pos + p->mask + 1, memory_order_release);
+                return task;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&p->head, memory_order_relaxed);
+        }
+    }
+}
+
+static inline void tp_run(tp_future_t *task) {
+    task->result = task->fn(task->arg);
+    /* The awaiter may free task as soon as it sees TP_DONE, so read nothing from it afterwards.
+     * The wake-up may then hit freed memory, which is harmless: futex waiters always recheck. */
+    if (atomic_exchange_explicit(&task->state, TP_DONE, memory_order_acq_rel) == TP_WAITED) {
+        tp_futex_wake(&task->state, INT_MAX);
+    }
+}
+
+/* Run one queued task on the calling thread; returns 0 if there was none */
+static inline int tp_run_one(tp_pool_t *p) {
+    tp_future_t *task = tp_try_pop(p);
+    if (!task) return 0;
+    tp_run(task);
+    return 1;
+}
+
+static void *tp_worker_main(void *arg) {
+    tp_pool_t *p = (tp_pool_t *)arg;
+    for (;;) {
+        int polls = 0;
+        while (polls++ <= p->spin) {
+            if (tp_run_one(p)) polls = 0;
+        }
+
+        /* Pairs with the fence in tp_submit(): either we see the new task, or the submitter
+         * sees us in sleepers and bumps wake_seq */
+        unsigned w = atomic_load_explicit(&p->wake_seq, memory_order_acquire);
+        atomic_fetch_add_explicit(&p->sleepers, 1, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        tp_future_t *task = tp_try_pop(p);
+        if (task) {
+            atomic_fetch_sub_explicit(&p->sleepers, 1, memory_order_relaxed);
+            tp_run(task);
+            continue;
+        }
+        if (atomic_load_explicit(&p->shutdown, memory_order_acquire)) {
+            atomic_fetch_sub_explicit(&p->sleepers, 1, memory_order_relaxed);
+            return NULL;
+        }
+        tp_futex_wait(&p->wake_seq, w);
+        atomic_fetch_sub_explicit(&p->sleepers, 1, memory_order_relaxed);
+    }
+}
+
+static inline void tp_destroy(tp_pool_t *p);
+
+/* Start nworkers threads with a queue of at least capacity tasks. Returns 0 on success, or -1
+ * with errno set and nothing left running or allocated. stack_size 0 keeps the default stack. */
+static inline int tp_init_stack(tp_pool_t *p, int nworkers, uint64_t capacity, size_t stack_size) {
+    if (nworkers < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t cap = 2;
+    while (cap < capacity) cap <<= 1;
+    p->cells = (tp_cell_t *)malloc(sizeof(tp_cell_t) * cap);
+    p->workers = (pthread_t *)malloc(sizeof(pthread_t) * (size_t)nworkers);
+    if (!p->cells || !p->workers) {
+        free(p->cells);
+        free(p->workers);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (uint64_t i = 0; i < cap; i++) atomic_init(&p->cells[i].seq, i);
+    p->mask = cap - 1;
+    atomic_init(&p->tail, 0);
+    atomic_init(&p->head, 0);
+    atomic_init(&p->wake_seq, 0);
+    atomic_init(&p->sleepers, 0);
+    atomic_init(&p->shutdown, 0);
+    p->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 256 : 0;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stack_size) pthread_attr_setstacksize(&attr, stack_size);
+    int rc = 0;
+    for (p->nworkers = 0; p->nworkers < nworkers; p->nworkers++) {
+        if ((rc = pthread_create(&p->workers[p->nworkers], &attr, tp_worker_main, p)) != 0) break;
+    }
+    pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        tp_destroy(p); /* stops and joins the workers started so far, frees the arrays */
+        errno = rc;
+        return -1;
+    }
+    return 0;
+}
+
+static inline int tp_init(tp_pool_t *p, int nworkers, uint64_t capacity) {
+    return tp_init_stack(p, nworkers, capacity, 0);
+}
+
+/* Run every task still queued, then stop and join the workers */
+static inline void tp_destroy(tp_pool_t *p) {
+    atomic_store_explicit(&p->shutdown, 1, memory_order_seq_cst);
+    atomic_fetch_add_explicit(&p->wake_seq, 1, memory_order_release);
+    tp_futex_wake(&p->wake_seq, INT_MAX);
+    for (int i = 0; i < p->nworkers; i++) {
+        pthread_join(p->workers[i], NULL);
+    }
+    free(p->workers);
+    free(p->cells);
+    p->workers = NULL;
+    p->cells = NULL;
+}
+
+/* Queue fn(arg); returns its future (NULL if out of memory), to be passed to tp_await() */
+static inline tp_future_t *tp_submit(tp_pool_t *p, tp_fn_t fn, void *arg) {
+    tp_future_t *f = (tp_future_t *)malloc(sizeof(tp_future_t));
+    if (!f) return NULL;
+    f->fn = fn;
+    f->arg = arg;
+    f->result = NULL;
+    atomic_init(&f->state, TP_PENDING);
+    while (!tp_try_push(p, f)) {
+        if (!tp_run_one(p)) sched_yield(); /* full: help drain it */
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&p->sleepers, memory_order_relaxed) > 0) {
+        atomic_fetch_add_explicit(&p->wake_seq, 1, memory_order_release);
+        tp_futex_wake(&p->wake_seq, 1);
+    }
+    return f;
+}
+
+/* Wait for f, free it and return fn's result. Runs other queued tasks while waiting. */
+static inline void *tp_await(tp_pool_t *p, tp_future_t *f) {
+    unsigned s;
+    while ((s = atomic_load_explicit(&f->state, memory_order_acquire)) != TP_DONE) {
+        if (tp_run_one(p)) continue;
+        if (s == TP_PENDING &&
+            !atomic_compare_exchange_strong_explicit(&f->state, &s, TP_WAITED, memory_order_acq_rel, memory_order_acquire)) {
+            continue; /* finished meanwhile */
+        }
+        tp_futex_wait(&f->state, TP_WAITED);
+    }
+    void *result = f->result;
+    free(f);
+    return result;
+}
+
+/* ---------------------------------------------------------------------------------------- */
+
+typedef struct {
+    _Atomic uint64_t next;
+    uint64_t n, grain;
+    void (*body)(uint64_t i, void *ctx);
+    void *ctx;
+} tp_range_t;
+
+/* Claim grain-sized chunks of the range until it is used up */
+static void *tp_range_worker(void *arg) {
+    tp_range_t *r = (tp_range_t *)arg;
+    uint64_t begin;
+    while ((begin = atomic_fetch_add_explicit(&r->next, r->grain, memory_order_relaxed)) < r->n) {
+        uint64_t end = begin + r->grain < r->n ? begin + r->grain : r->n;
+        for (uint64_t i = begin; i < end; i++) r->body(i, r->ctx);
+    }
+    return NULL;
+}
+
+/* body(i, ctx) for every i in [0, n), in chunks of grain iterations. The caller works on the
+ * range too, so it may be called from inside a task. Returns once every iteration is done. */
+static inline void tp_parallel_for(tp_pool_t *p, uint64_t n, uint64_t grain, void (*body)(uint64_t i, void *ctx),
+                                   void *ctx) {
+    if (grain < 1) grain = 1;
+    tp_range_t r;
+    atomic_init(&r.next, 0);
+    r.n = n;
+    r.grain = grain;
+    r.body = body;
+    r.ctx = ctx;
+
+    uint64_t chunks = (n + grain - 1) / grain;
+    int helpers = chunks > (uint64_t)p->nworkers ? p->nworkers : (int)(chunks > 0 ? chunks - 1 : 0);
+    tp_future_t *stack_futures[64];
+    tp_future_t **futures = helpers <= 64 ? stack_futures : (tp_future_t **)malloc(sizeof(tp_future_t *) * (size_t)helpers);
+    int submitted = 0;
+    for (; futures && submitted < helpers; submitted++) {
+        futures[submitted] = tp_submit(p, tp_range_worker, &r);
+        if (!futures[submitted]) break;
+    }
+    tp_range_worker(&r);
+    for (int i = 0; i < submitted; i++) {
+        tp_await(p, futures[i]);
+    }
+    if (futures != stack_futures) free(futures);
+}
+
+#endif
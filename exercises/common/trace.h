@@ -0,0 +1,322 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Timeline instrumentation for the semaphore exercises, exported as Chrome trace JSON (open it
+ * in https://ui.perfetto.dev or chrome://tracing). Compiled in only with -DTRACE; otherwise
+ * every macro below is the plain call or nothing at all.
+ *
+ *   trace_init();                                     // start of main
+ *   trace_thread_name("Philosopher", idx);            // label of the calling thread's track
+ *   trace_sem_wait(&sticks[i], "chopstick", i);       // sem_wait(), recorded as a span
+ *   uint64_t t = trace_now(); eat(); trace_span("eat", "philosopher", idx, t);
+ *   trace_instant("arrive", "customer", id);          // a single point in time
+ *   trace_async_begin("chair", c); ... trace_async_end("chair", c);   // may end on another thread
+ *   trace_export("prog.trace.json");                  // after the joins; TRACE_JSON overrides the path
+ *
+ * Each thread appends fixed-size events (begin and end timestamp, name, one integer argument) to
+ * its own buffer, so recording takes no lock. Calls that can block (sem_wait, pthread_join) are
+ * spans; sem_trywait and sem_post are instants, which cost one timestamp instead of two.
+ * Timestamps are rdtsc on x86-64, converted to time at export against CLOCK_MONOTONIC, and
+ * clock_gettime() elsewhere. A thread keeps at most
+ * TRACE_MAX_EVENTS events; later ones are counted and dropped. The export also prints the
+ * semaphores that blocked the longest, by argument, e.g. the time spent waiting per chopstick.
+ */
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+
+#ifdef TRACE
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__)
+# include <x86intrin.h>
+#endif
+
+#ifndef TRACE_MAX_EVENTS
+# define TRACE_MAX_EVENTS 65536 /* per thread */
+#endif
+
+typedef struct {
+    uint64_t start, end; /* trace_now() ticks */
+    const char *name;
+    const char *key; /* name of arg in the viewer, NULL for none */
+    int arg;
+    char ph; /* 'X' span, 'i' instant (start only), 'b' / 'e' async begin / end (arg is the id) */
+} trace_event_t;
+
+typedef struct trace_buf {
+    trace_event_t *ev;
+    uint32_t n, cap, dropped;
+    uint32_t tid;
+    char name[32];
+    struct trace_buf *next;
+} trace_buf_t;
+
+static struct {
+    _Atomic(trace_buf_t *) bufs;
+    _Atomic uint32_t next_tid;
+    uint64_t tick0, ns0; /* trace_now() and CLOCK_MONOTONIC at trace_init() */
+} trace_g;
+
+static __thread trace_buf_t *trace_self;
+
+static inline uint64_t trace_mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t trace_now(void) {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    return trace_mono_ns();
+#endif
+}
+
+static inline void trace_init(void) {
+    trace_g.tick0 = trace_now();
+    trace_g.ns0 = trace_mono_ns();
+}
+
+static trace_buf_t *trace_register(void) {
+    trace_buf_t *b = (trace_buf_t *)calloc(1, sizeof(trace_buf_t));
+    if (!b) {
+        perror("trace");
+        exit(1);
+    }
+    b->tid = atomic_fetch_add_explicit(&trace_g.next_tid, 1, memory_order_relaxed) + 1;
+    b->next = atomic_load_explicit(&trace_g.bufs, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&trace_g.bufs, &b->next, b, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    trace_self = b;
+    return b;
+}
+
+/* Slow path: first event of the thread, or its buffer is full */
+static trace_event_t *trace_grow(trace_buf_t *b) {
+    if (b->cap == TRACE_MAX_EVENTS) {
+        b->dropped++;
+        return NULL;
+    }
+    uint32_t cap = b->cap ? b->cap * 2 : 64;
+    if (cap > TRACE_MAX_EVENTS) cap = TRACE_MAX_EVENTS;
+    trace_event_t *ev = (trace_event_t *)realloc(b->ev, sizeof(trace_event_t) * cap);
+    if (!ev) {
+        b->dropped++;
+        return NULL;
+    }
+    b->ev = ev;
+    b->cap = cap;
+    return &b->ev[b->n++];
+}
+
+static inline void trace_event(char ph, const char *name, const char *key, int arg, uint64_t start, uint64_t end) {
+    trace_buf_t *b = trace_self ? trace_self : trace_register();
+    trace_event_t *e = b->n < b->cap ? &b->ev[b->n++] : trace_grow(b);
+    if (!e) return;
+    e->start = start;
+    e->end = end;
+    e->name = name;
+    e->key = key;
+    e->arg = arg;
+    e->ph = ph;
+}
+
+static inline void trace_thread_name(const char *name, long idx) {
+    trace_buf_t *b = trace_self ? trace_self : trace_register();
+    snprintf(b->name, sizeof(b->name), idx >= 0 ? "%s %ld" : "%s", name, idx);
+}
+
+#define trace_span(name, key, arg, start) trace_event('X', (name), (key), (arg), (start), trace_now())
+#define trace_instant(name, key, arg) trace_event('i', (name), (key), (arg), trace_now(), 0)
+#define trace_async_begin(name, id) trace_event('b', (name), NULL, (id), trace_now(), 0)
+#define trace_async_end(name, id) trace_event('e', (name), NULL, (id), trace_now(), 0)
+
+static inline int trace_sem_wait(sem_t *s, const char *key, int idx) {
+    uint64_t t = trace_now();
+    int r = sem_wait(s);
+    trace_span("sem_wait", key, idx, t);
+    return r;
+}
+
+/* sem_trywait() and sem_post() never block: one timestamp each, half the cost of a span */
+static inline int trace_sem_trywait(sem_t *s, const char *key, int idx) {
+    int r = sem_trywait(s);
+    trace_instant(r == 0 ? "sem_trywait" : "sem_trywait (busy)", key, idx);
+    return r;
+}
+
+static inline int trace_sem_post(sem_t *s, const char *key, int idx) {
+    int r = sem_post(s);
+    trace_instant("sem_post", key, idx);
+    return r;
+}
+
+static inline int trace_pthread_create(pthread_t *tid, const pthread_attr_t *attr, void *(*fn)(void *), void *arg) {
+    uint64_t t = trace_now();
+    int r = pthread_create(tid, attr, fn, arg);
+    trace_span("pthread_create", NULL, 0, t);
+    return r;
+}
+
+static inline int trace_pthread_join(pthread_t tid, void **result) {
+    uint64_t t = trace_now();
+    int r = pthread_join(tid, result);
+    trace_span("pthread_join", NULL, 0, t);
+    return r;
+}
+
+typedef struct {
+    const char *key;
+    int arg;
+    uint64_t ticks, waits, busy; /* time and calls in sem_wait, failed sem_trywait calls */
+} trace_total_t;
+
+static int trace_total_by_arg(const void *a, const void *b) {
+    const trace_total_t *x = (const trace_total_t *)a, *y = (const trace_total_t *)b;
+    int c = strcmp(x->key, y->key);
+    if (c != 0) return c;
+    return x->arg < y->arg ? -1 : x->arg > y->arg;
+}
+
+static int trace_total_by_time(const void *a, const void *b) {
+    const trace_total_t *x = (const trace_total_t *)a, *y = (const trace_total_t *)b;
+    if (x->ticks != y->ticks) return x->ticks < y->ticks ? 1 : -1;
+    return x->busy < y->busy ? 1 : x->busy > y->busy ? -1 : 0;
+}
+
+/* Top 5 semaphores by time blocked in sem_wait, then by failed sem_trywait calls */
+static void trace_summary(double ns_per_tick) {
+    size_t n = 0, cap = 0;
+    trace_total_t *t = NULL;
+    for (trace_buf_t *b = atomic_load(&trace_g.bufs); b; b = b->next) {
+        for (uint32_t i = 0; i < b->n; i++) {
+            const trace_event_t *e = &b->ev[i];
+            int wait = strcmp(e->name, "sem_wait") == 0, busy = strcmp(e->name, "sem_trywait (busy)") == 0;
+            if (!e->key || !(wait || busy)) continue;
+            if (n == cap) {
+                cap = cap ? cap * 2 : 1024;
+                t = (trace_total_t *)realloc(t, sizeof(trace_total_t) * cap);
+                if (!t) return;
+            }
+            t[n++] = (trace_total_t){e->key, e->arg, wait ? e->end - e->start : 0, (uint64_t)wait, (uint64_t)busy};
+        }
+    }
+    if (n == 0) return;
+
+    qsort(t, n, sizeof(trace_total_t), trace_total_by_arg);
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (m > 0 && trace_total_by_arg(&t[m - 1], &t[i]) == 0) {
+            t[m - 1].ticks += t[i].ticks;
+            t[m - 1].waits += t[i].waits;
+            t[m - 1].busy += t[i].busy;
+        } else {
+            t[m++] = t[i];
+        }
+    }
+    qsort(t, m, sizeof(trace_total_t), trace_total_by_time);
+    fprintf(stderr, "most contended, by time blocked in sem_wait and failed sem_trywait calls:\n");
+    for (size_t i = 0; i < m && i < 5; i++) {
+        fprintf(stderr, "  %s %-8d %12.3f ms in %llu sem_wait, %llu busy sem_trywait\n", t[i].key, t[i].arg,
+                (double)t[i].ticks * ns_per_tick / 1e6, (unsigned long long)t[i].waits,
+                (unsigned long long)t[i].busy);
+    }
+    free(t);
+}
+
+/* Writes every thread's events as Chrome trace JSON and frees them; call after the joins */
+static inline void trace_export(const char *path) {
+    const char *env = getenv("TRACE_JSON");
+    if (env && *env) path = env;
+
+    /* Ticks per nanosecond from the whole run; make it at least 10 ms long for a usable ratio */
+    uint64_t ns1 = trace_mono_ns();
+    if (ns1 - trace_g.ns0 < 10000000) {
+        struct timespec ts = {0, (long)(10000000 - (ns1 - trace_g.ns0))};
+        nanosleep(&ts, NULL);
+    }
+    uint64_t tick1 = trace_now();
+    ns1 = trace_mono_ns();
+    double ns_per_tick = (double)(ns1 - trace_g.ns0) / (double)(tick1 - trace_g.tick0);
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror(path);
+        return;
+    }
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    int first = 1;
+    uint64_t events = 0, dropped = 0, threads = 0;
+    for (trace_buf_t *b = atomic_load(&trace_g.bufs); b; b = b->next) {
+        threads++;
+        dropped += b->dropped;
+        if (b->name[0]) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", b->tid, b->name);
+            first = 0;
+        }
+        for (uint32_t i = 0; i < b->n; i++) {
+            const trace_event_t *e = &b->ev[i];
+            double ts = (double)(int64_t)(e->start - trace_g.tick0) * ns_per_tick / 1e3;
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,\"ts\":%.3f", first ? "" : ",\n",
+                    e->name, e->ph, b->tid, ts);
+            first = 0;
+            if (e->ph == 'X' || e->ph == 'i') {
+                if (e->ph == 'X') fprintf(f, ",\"dur\":%.3f", (double)(e->end - e->start) * ns_per_tick / 1e3);
+                else fprintf(f, ",\"s\":\"t\"");
+                if (e->key) fprintf(f, ",\"args\":{\"%s\":%d}", e->key, e->arg);
+            } else {
+                fprintf(f, ",\"cat\":\"%s\",\"id\":%d", e->name, e->arg);
+            }
+            fputc('}', f);
+            events++;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    fprintf(stderr, "trace: %llu events from %llu threads written to %s", (unsigned long long)events,
+            (unsigned long long)threads, path);
+    if (dropped) fprintf(stderr, " (%llu dropped, TRACE_MAX_EVENTS per thread)", (unsigned long long)dropped);
+    fprintf(stderr, "\n");
+    trace_summary(ns_per_tick);
+
+    trace_buf_t *b = atomic_load(&trace_g.bufs);
+    while (b) {
+        trace_buf_t *next = b->next;
+        free(b->ev);
+        free(b);
+        b = next;
+    }
+    atomic_store(&trace_g.bufs, NULL);
+    trace_self = NULL;
+}
+
+#else /* !TRACE: no code, no data */
+
+#define trace_init() ((void)0)
+#define trace_now() ((uint64_t)0)
+#define trace_thread_name(name, idx) ((void)0)
+#define trace_span(name, key, arg, start) ((void)(start))
+#define trace_instant(name, key, arg) ((void)0)
+#define trace_async_begin(name, id) ((void)(id))
+#define trace_async_end(name, id) ((void)(id))
+#define trace_sem_wait(s, key, idx) sem_wait(s)
+#define trace_sem_trywait(s, key, idx) sem_trywait(s)
+#define trace_sem_post(s, key, idx) sem_post(s)
+#define trace_pthread_create(tid, attr, fn, arg) pthread_create((tid), (attr), (fn), (arg))
+#define trace_pthread_join(tid, result) pthread_join((tid), (result))
+#define trace_export(path) ((void)0)
+
+#endif
+
+#endif
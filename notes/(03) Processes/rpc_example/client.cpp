@@ -1,20 +1,22 @@
 #include "rpc_client.hpp"
+#include "rpc_protocol.hpp"
 #include <stdio.h>
 
 int main(int argc, char** argv) {
-    // Get IP address from command line or use localhost
-    const char* ip = (argc > 1) ? argv[1] : "127.0.0.1";
+    // Get the server address from command line or use localhost
+    // (IP[:PORT], tcp:IP[:PORT], unix:PATH or shm:NAME)
+    const char* address = (argc > 1) ? argv[1] : "127.0.0.1:8080";
     
     // Create RPC client
     RpcClient c;
     
     // Connect to RPC server
-    if (!rpc_connect(c, ip, 8080)) {
+    if (!rpc_connect(c, address)) {
         fprintf(stderr, "connect failed\n");
         return 1;
     }
     
-    printf("Connected to RPC server at %s:8080\n", ip);
+    printf("Connected to RPC server at %s\n", address);
     
     // Perform remote procedure calls
     long long result;
@@ -46,6 +48,34 @@ int main(int argc, char** argv) {
         printf("div(10, 0) failed (division by zero)\n");
     }
     
+    // Pipelined calls: issue several requests before waiting for any reply
+    uint32_t ids[4];
+    for (int i = 0; i < 4; i++) {
+        rpc_call_async(c, RPC_OP_MUL, i + 1, 10, ids[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        if (rpc_wait(c, ids[i], result)) {
+            printf("pipelined mul(%d, 10) = %lld\n", i + 1, result);
+        }
+    }
+
+    // Batched calls: all requests go out in one writev()
+    RpcCall batch[] = {
+        {RPC_OP_ADD, 1, 2, false, 0},
+        {RPC_OP_SUB, 9, 3, false, 0},
+        {RPC_OP_DIV, 7, 0, false, 0},
+    };
+    const char* names[] = {"quit", "add", "sub", "mul", "div"};
+    if (rpc_batch(c, batch, 3)) {
+        for (const RpcCall& call : batch) {
+            if (call.ok) {
+                printf("batch %s(%lld, %lld) = %lld\n", names[call.opcode], call.a, call.b, call.result);
+            } else {
+                printf("batch %s(%lld, %lld) failed\n", names[call.opcode], call.a, call.b);
+            }
+        }
+    }
+    
     // Close connection
     rpc_close(c);
     printf("RPC client finished\n");
@@ -0,0 +1,135 @@
+// Microbenchmark: cost of resolving and calling a procedure as the registry grows.
+//
+//   linear  - strcmp scan over the registry (the original find_proc())
+//   phash   - compile-time perfect hash on the name (text protocol path)
+//   opcode  - direct index by opcode (binary protocol path)
+//
+// Registries of 4..1000 procedures named "p0", "p1", ... are generated at compile time.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "rpc_registry.hpp"
+
+#define LOOKUPS 2000000
+
+typedef int (*proc_fn)(const long long *args, long long *out);
+
+struct BenchProc {
+    const char *name;
+    int arity;
+    proc_fn fn;
+};
+
+static int bench_impl(const long long *args, long long *out) {
+    *out = args[0] + args[1];
+    return 0;
+}
+
+template <size_t N>
+struct Registry {
+    struct Names {
+        char text[N][8];
+    };
+    struct Table {
+        BenchProc e[N];
+    };
+
+    static constexpr Names make_names() {
+        Names n{};
+        for (size_t i = 0; i < N; i++) {
+            // "p" followed by the decimal index
+            char digits[8] = {};
+            size_t len = 0;
+            size_t v = i;
+            do {
+                digits[len++] = (char)('0' + v % 10);
+                v /= 10;
+            } while (v > 0);
+            n.text[i][0] = 'p';
+            for (size_t k = 0; k < len; k++) n.text[i][1 + k] = digits[len - 1 - k];
+        }
+        return n;
+    }
+
+    static constexpr Names names = make_names();
+
+    static constexpr Table make_table() {
+        Table t{};
+        for (size_t i = 0; i < N; i++) t.e[i] = BenchProc{names.text[i], 2, bench_impl};
+        return t;
+    }
+
+    static constexpr Table table = make_table();
+    static constexpr PerfectHash<N> hash = build_perfect_hash(table.e);
+    static_assert(hash.ok, "generated names must be unique");
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+template <size_t N>
+static void run(void) {
+    using R = Registry<N>;
+
+    // Random query order, copied into mutable arrays so the compiler cannot fold the lookups
+    static char queries[4096][8];
+    static uint16_t opcodes[4096];
+    unsigned seed = 12345;
+    for (int i = 0; i < 4096; i++) {
+        size_t idx = (size_t)rand_r(&seed) % N;
+        memcpy(queries[i], R::names.text[idx], 8);
+        opcodes[i] = (uint16_t)idx;
+    }
+
+    long long args[2] = {1, 2};
+    long long out = 0, sink = 0;
+
+    double t0 = now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        const char *name = queries[i & 4095];
+        for (size_t k = 0; k < N; k++) {
+            if (strcmp(R::table.e[k].name, name) == 0) {
+                R::table.e[k].fn(args, &out);
+                break;
+            }
+        }
+        sink += out;
+    }
+    double linear = (now_ns() - t0) / LOOKUPS;
+
+    t0 = now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        int idx = registry_find(R::table.e, R::hash, queries[i & 4095]);
+        if (idx >= 0) R::table.e[idx].fn(args, &out);
+        sink += out;
+    }
+    double phash = (now_ns() - t0) / LOOKUPS;
+
+    t0 = now_ns();
+    for (int i = 0; i < LOOKUPS; i++) {
+        uint16_t op = opcodes[i & 4095];
+        if (op < N) R::table.e[op].fn(args, &out);
+        sink += out;
+    }
+    double opcode = (now_ns() - t0) / LOOKUPS;
+
+    printf("%6zu %12.1f %12.1f %12.1f\n", N, linear, phash, opcode);
+    if (sink == 42) printf("\n"); // keep the loops observable
+}
+
+int main(void) {
+    printf("ns per lookup+call (%d lookups each)\n", LOOKUPS);
+    printf("%6s %12s %12s %12s\n", "procs", "linear", "phash", "opcode");
+    run<4>();
+    run<16>();
+    run<64>();
+    run<256>();
+    run<1000>();
+    return 0;
+}
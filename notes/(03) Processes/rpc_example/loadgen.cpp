@@ -0,0 +1,591 @@
+// Load generator for rpc_server (binary protocol) and the sockets_example echo servers.
+//
+// Closed loop: every connection keeps `depth` requests outstanding and sends the next one as
+// soon as a reply comes back. Open loop (-R): requests are scheduled at a fixed total rate no
+// matter how fast the server answers, and each latency is measured from the time the request
+// was *scheduled*, not from when it could finally be sent. A stalled server therefore shows
+// up as a stall in every request that should have been issued meanwhile, instead of silently
+// lowering the offered load (coordinated omission).
+//
+// Results are printed as one JSON object on stdout.
+#include "rpc_protocol.hpp"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <deque>
+#include <vector>
+
+#define MAX_THREADS 256
+#define MAX_EVENTS 256
+#define DRAIN_TIMEOUT_NS 2000000000LL // wait this long for outstanding replies after the run
+
+// ---------------------------------------------------------------------------------------
+// HDR-style latency histogram
+//
+// Values below 2^11 ns get a counter each; above that every power-of-two range is split into
+// 1024 linear sub-buckets, so any recorded value is off by less than 0.1% while the whole
+// range up to ~2^40 ns (18 minutes) costs a fixed ~250 KB of counters.
+// ---------------------------------------------------------------------------------------
+
+#define HIST_SUB_BITS 10
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)
+#define HIST_MAX_SHIFT 30
+#define HIST_SIZE (2 * HIST_SUB_COUNT + HIST_MAX_SHIFT * HIST_SUB_COUNT)
+
+struct Histogram {
+    std::vector<uint64_t> counts = std::vector<uint64_t>(HIST_SIZE);
+    uint64_t total = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    double sum = 0;
+};
+
+static size_t hist_index(uint64_t v) {
+    if (v < 2 * HIST_SUB_COUNT) return (size_t)v;
+    int shift = 63 - __builtin_clzll(v) - HIST_SUB_BITS; // v >> shift lands in [1024, 2048)
+    if (shift > HIST_MAX_SHIFT) return HIST_SIZE - 1;
+    return (size_t)(2 * HIST_SUB_COUNT + (shift - 1) * HIST_SUB_COUNT + ((v >> shift) - HIST_SUB_COUNT));
+}
+
+// Largest value that maps to the same counter as index i (what HdrHistogram reports)
+static uint64_t hist_value(size_t i) {
+    if (i < 2 * HIST_SUB_COUNT) return i;
+    size_t shift = (i - 2 * HIST_SUB_COUNT) / HIST_SUB_COUNT + 1;
+    uint64_t sub = (i - 2 * HIST_SUB_COUNT) % HIST_SUB_COUNT + HIST_SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+static void hist_record(Histogram &h, uint64_t v) {
+    h.counts[hist_index(v)]++;
+    h.total++;
+    h.sum += (double)v;
+    if (v < h.min) h.min = v;
+    if (v > h.max) h.max = v;
+}
+
+// Closed-loop correction (HdrHistogram's recordValueWithExpectedInterval): a request that took
+// k expected intervals hid k-1 requests that a steady client would have sent meanwhile, with
+// latencies v - interval, v - 2*interval, ...
+static void hist_record_corrected(Histogram &h, uint64_t v, uint64_t expected_interval) {
+    hist_record(h, v);
+    if (expected_interval == 0 || v <= expected_interval) return;
+    for (uint64_t missing = v - expected_interval; missing >= expected_interval; missing -= expected_interval) {
+        hist_record(h, missing);
+    }
+}
+
+static void hist_merge(Histogram &into, const Histogram &from) {
+    for (size_t i = 0; i < HIST_SIZE; i++) into.counts[i] += from.counts[i];
+    into.total += from.total;
+    into.sum += from.sum;
+    if (from.min < into.min) into.min = from.min;
+    if (from.max > into.max) into.max = from.max;
+}
+
+static uint64_t hist_percentile(const Histogram &h, double pct) {
+    if (h.total == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(pct / 100.0 * (double)h.total);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HIST_SIZE; i++) {
+        seen += h.counts[i];
+        if (seen >= rank) return hist_value(i) < h.max ? hist_value(i) : h.max;
+    }
+    return h.max;
+}
+
+// ---------------------------------------------------------------------------------------
+// Configuration
+// ---------------------------------------------------------------------------------------
+
+enum Target { TARGET_RPC, TARGET_ECHO };
+
+static const char *op_names[] = {"quit", "add", "sub", "mul", "div"};
+#define NUM_OPS 4 // add, sub, mul, div (opcodes 1..4)
+
+struct Config {
+    Target target = TARGET_RPC;
+    const char *host = "127.0.0.1";
+    const char *port = "8080";
+    int connections = 16;
+    int threads = 1;
+    int depth = 1; // requests kept outstanding per connection
+    double seconds = 10;
+    double rate = 0; // total requests/sec; 0 = closed loop
+    int mix[NUM_OPS + 1] = {0, 25, 25, 25, 25}; // weight per opcode
+    int mix_total = 100;
+    int msg_bytes = 64; // echo payload size
+    uint64_t expected_interval_ns = 0; // closed-loop coordinated omission correction
+};
+
+static Config cfg;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// ---------------------------------------------------------------------------------------
+// Connections
+// ---------------------------------------------------------------------------------------
+
+// A request that has been sent and is waiting for its reply
+struct Outstanding {
+    uint64_t intended; // scheduled send time: latencies are measured from here
+    uint32_t req_id;
+    long long expected; // RPC result we should get back
+};
+
+struct Conn {
+    int fd = -1;
+    std::deque<Outstanding> inflight; // replies arrive in request order on one connection
+    std::vector<char> out; // encoded requests the socket has not accepted yet
+    size_t out_off = 0;
+    std::vector<char> in; // received bytes not yet matched to requests
+    size_t echo_pending = 0; // echo: bytes of the oldest reply received so far
+    uint64_t next_send = 0; // open loop: scheduled time of the next request
+    uint64_t interval = 0; // open loop: time between this connection's requests
+    uint32_t next_id = 0;
+    unsigned rng = 0;
+    bool dead = false;
+};
+
+struct Worker {
+    int id;
+    pthread_t tid;
+    std::vector<Conn> conns;
+    Histogram hist;
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t unfinished = 0; // scheduled or sent before the deadline but never answered
+    uint64_t op_counts[NUM_OPS + 1] = {};
+};
+
+static uint64_t run_start, run_end;
+static const char *echo_payload;
+
+// Blocking connect plus, for the RPC server, the switch to binary frames
+static int open_conn(void) {
+    struct addrinfo hints = {}, *res;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(cfg.host, cfg.port, &hints, &res) != 0) return -1;
+    int fd = socket(res->ai_family, res->ai_socktype | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, res->ai_addr, res->ai_addrlen) < 0) {
+        if (fd >= 0) close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+    freeaddrinfo(res);
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (cfg.target == TARGET_RPC) {
+        const char *hello = RPC_HELLO_LINE;
+        char reply[64];
+        size_t got = 0;
+        if (send(fd, hello, strlen(hello), MSG_NOSIGNAL) != (ssize_t)strlen(hello)) {
+            close(fd);
+            return -1;
+        }
+        // Read exactly one line: binary frames must not be consumed here
+        while (got < sizeof(reply) - 1) {
+            ssize_t r = read(fd, reply + got, 1);
+            if (r <= 0) break;
+            if (reply[got++] == '\n') break;
+        }
+        reply[got] = '\0';
+        if (strcmp(reply, RPC_HELLO_REPLY) != 0) {
+            fprintf(stderr, "server did not accept the binary protocol: %s", got ? reply : "(no reply)\n");
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ---------------------------------------------------------------------------------------
+// Requests and replies
+// ---------------------------------------------------------------------------------------
+
+static uint16_t pick_op(Conn &c) {
+    int r = rand_r(&c.rng) % cfg.mix_total;
+    for (uint16_t op = 1; op <= NUM_OPS; op++) {
+        if (r < cfg.mix[op]) return op;
+        r -= cfg.mix[op];
+    }
+    return RPC_OP_ADD;
+}
+
+// Append one request to c.out and remember when it was supposed to go out
+static void queue_request(Worker *w, Conn &c, uint64_t intended) {
+    Outstanding o;
+    o.intended = intended;
+    o.req_id = c.next_id++;
+    o.expected = 0;
+
+    if (cfg.target == TARGET_ECHO) {
+        c.out.insert(c.out.end(), echo_payload, echo_payload + cfg.msg_bytes);
+        c.inflight.push_back(o);
+        return;
+    }
+
+    uint16_t op = pick_op(c);
+    long long a = rand_r(&c.rng) % 2001 - 1000;
+    long long b = rand_r(&c.rng) % 2001 - 1000;
+    if (op == RPC_OP_DIV && b == 0) b = 1;
+    switch (op) {
+    case RPC_OP_ADD: o.expected = a + b; break;
+    case RPC_OP_SUB: o.expected = a - b; break;
+    case RPC_OP_MUL: o.expected = a * b; break;
+    case RPC_OP_DIV: o.expected = a / b; break;
+    }
+
+    int64_t args[2] = {a, b};
+    char frame[RPC_HEADER_SIZE + 16];
+    size_t len = rpc_encode_frame(frame, op, o.req_id, args, 2);
+    c.out.insert(c.out.end(), frame, frame + len);
+    c.inflight.push_back(o);
+    w->op_counts[op]++;
+}
+
+static void kill_conn(Worker *w, Conn &c) {
+    if (c.dead) return;
+    c.dead = true;
+    w->errors += c.inflight.size();
+    c.inflight.clear();
+    close(c.fd);
+}
+
+// Write as much of c.out as the socket takes; the rest waits for EPOLLOUT
+static void flush(Worker *w, Conn &c) {
+    while (c.out_off < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.out_off, c.out.size() - c.out_off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN) kill_conn(w, c);
+            return;
+        }
+        c.out_off += (size_t)n;
+    }
+    c.out.clear();
+    c.out_off = 0;
+}
+
+static void complete(Worker *w, Conn &c, uint64_t now) {
+    const Outstanding &o = c.inflight.front();
+    uint64_t latency = now > o.intended ? now - o.intended : 0;
+    if (cfg.rate > 0) {
+        hist_record(w->hist, latency); // already measured from the schedule
+    } else {
+        hist_record_corrected(w->hist, latency, cfg.expected_interval_ns);
+    }
+    w->completed++;
+    c.inflight.pop_front();
+}
+
+static void read_replies(Worker *w, Conn &c) {
+    char buf[65536];
+    for (;;) {
+        ssize_t n = read(c.fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno == EAGAIN) return;
+        if (n <= 0) {
+            kill_conn(w, c);
+            return;
+        }
+        uint64_t now = now_ns();
+
+        if (cfg.target == TARGET_ECHO) {
+            // The echo comes back in order, so bytes are matched to requests by count alone
+            size_t left = (size_t)n;
+            while (left > 0 && !c.inflight.empty()) {
+                size_t take = (size_t)cfg.msg_bytes - c.echo_pending;
+                if (take > left) take = left;
+                c.echo_pending += take;
+                left -= take;
+                if (c.echo_pending == (size_t)cfg.msg_bytes) {
+                    c.echo_pending = 0;
+                    complete(w, c, now);
+                }
+            }
+            continue;
+        }
+
+        c.in.insert(c.in.end(), buf, buf + n);
+        size_t off = 0;
+        RpcFrame f;
+        int len;
+        while ((len = rpc_parse_frame(c.in.data() + off, c.in.size() - off, &f)) > 0) {
+            off += (size_t)len;
+            if (c.inflight.empty() || f.req_id != c.inflight.front().req_id) {
+                kill_conn(w, c); // the server must answer in request order
+                return;
+            }
+            if (f.opcode != RPC_OK || f.argc != 1 || rpc_frame_arg(&f, 0) != c.inflight.front().expected) {
+                w->errors++;
+            }
+            complete(w, c, now);
+        }
+        if (len < 0) {
+            kill_conn(w, c);
+            return;
+        }
+        c.in.erase(c.in.begin(), c.in.begin() + (long)off);
+    }
+}
+
+// Queue every request that is due on c, then try to send them
+static void issue(Worker *w, Conn &c, uint64_t now) {
+    size_t before = c.inflight.size();
+    if (cfg.rate > 0) {
+        // A request whose slot is taken stays due; it goes out late but keeps its scheduled time
+        while (c.next_send <= now && c.next_send < run_end && c.inflight.size() < (size_t)cfg.depth) {
+            queue_request(w, c, c.next_send);
+            c.next_send += c.interval;
+        }
+    } else {
+        while (now < run_end && c.inflight.size() < (size_t)cfg.depth) {
+            queue_request(w, c, now);
+        }
+    }
+    if (c.inflight.size() != before) flush(w, c);
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = (Worker *)arg;
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return NULL;
+    }
+    for (size_t i = 0; i < w->conns.size(); i++) {
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.u64 = i;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, w->conns[i].fd, &ev);
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    uint64_t drain_deadline = run_end + DRAIN_TIMEOUT_NS;
+    for (;;) {
+        uint64_t now = now_ns();
+        uint64_t wake = now < run_end ? run_end : drain_deadline;
+        bool busy = false;
+        for (Conn &c : w->conns) {
+            if (c.dead) continue;
+            issue(w, c, now);
+            if (!c.inflight.empty()) busy = true;
+            if (cfg.rate > 0 && c.next_send < run_end) {
+                busy = true;
+                if (c.inflight.size() < (size_t)cfg.depth && c.next_send < wake) wake = c.next_send;
+            }
+        }
+        if ((now >= run_end && !busy) || now >= drain_deadline) break;
+
+        uint64_t wait = wake > now ? wake - now : 0;
+        struct timespec timeout = {(time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull)};
+        int n = epoll_pwait2(epfd, events, MAX_EVENTS, &timeout, NULL);
+        if (n < 0 && errno != EINTR) {
+            perror("epoll_pwait2");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            Conn &c = w->conns[events[i].data.u64];
+            if (c.dead) continue;
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) read_replies(w, c);
+            if (!c.dead && (events[i].events & EPOLLOUT)) flush(w, c);
+        }
+    }
+
+    // Anything still owed at this point never got an answer in time
+    for (Conn &c : w->conns) {
+        if (c.dead) continue;
+        w->unfinished += c.inflight.size();
+        if (cfg.rate > 0) {
+            for (; c.next_send < run_end; c.next_send += c.interval) w->unfinished++;
+        }
+        close(c.fd);
+    }
+    close(epfd);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------------------
+// Command line and report
+// ---------------------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -t rpc|echo   server type (default rpc)\n"
+            "  -h host       server address (default 127.0.0.1)\n"
+            "  -p port       server port (default 8080)\n"
+            "  -c N          connections (default 16)\n"
+            "  -T N          client threads (default 1)\n"
+            "  -d N          pipeline depth: requests outstanding per connection (default 1)\n"
+            "  -s seconds    run time (default 10)\n"
+            "  -R rate       open loop at this many requests/sec in total (default: closed loop)\n"
+            "  -m mix        rpc op weights, e.g. add=70,div=30 (default: equal)\n"
+            "  -b bytes      echo message size (default 64)\n"
+            "  -i usec       closed loop: expected interval for coordinated omission correction\n",
+            prog);
+}
+
+static bool parse_mix(const char *spec) {
+    int mix[NUM_OPS + 1] = {};
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+    char *save = NULL;
+    for (char *tok = strtok_r(copy, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        char *eq = strchr(tok, '=');
+        if (!eq) return false;
+        *eq = '\0';
+        int op = 1;
+        while (op <= NUM_OPS && strcmp(op_names[op], tok) != 0) op++;
+        if (op > NUM_OPS || atoi(eq + 1) < 0) return false;
+        mix[op] = atoi(eq + 1);
+    }
+    cfg.mix_total = 0;
+    for (int op = 1; op <= NUM_OPS; op++) {
+        cfg.mix[op] = mix[op];
+        cfg.mix_total += mix[op];
+    }
+    return cfg.mix_total > 0;
+}
+
+static bool parse_args(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc || argv[i][0] != '-' || strlen(argv[i]) != 2) return false;
+        const char *v = argv[++i];
+        switch (argv[i - 1][1]) {
+        case 't':
+            if (strcmp(v, "rpc") == 0) cfg.target = TARGET_RPC;
+            else if (strcmp(v, "echo") == 0) cfg.target = TARGET_ECHO;
+            else return false;
+            break;
+        case 'h': cfg.host = v; break;
+        case 'p': cfg.port = v; break;
+        case 'c': cfg.connections = atoi(v); break;
+        case 'T': cfg.threads = atoi(v); break;
+        case 'd': cfg.depth = atoi(v); break;
+        case 's': cfg.seconds = atof(v); break;
+        case 'R': cfg.rate = atof(v); break;
+        case 'm':
+            if (!parse_mix(v)) return false;
+            break;
+        case 'b': cfg.msg_bytes = atoi(v); break;
+        case 'i': cfg.expected_interval_ns = (uint64_t)(atof(v) * 1000.0); break;
+        default: return false;
+        }
+    }
+    if (cfg.threads > cfg.connections) cfg.threads = cfg.connections;
+    return cfg.connections > 0 && cfg.threads > 0 && cfg.threads <= MAX_THREADS && cfg.depth > 0 &&
+           cfg.depth <= 1024 && cfg.seconds > 0 && cfg.rate >= 0 && cfg.msg_bytes > 0;
+}
+
+int main(int argc, char **argv) {
+    if (!parse_args(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    std::vector<char> payload((size_t)cfg.msg_bytes, 'x');
+    echo_payload = payload.data();
+
+    static Worker workers[MAX_THREADS];
+    for (int i = 0; i < cfg.threads; i++) workers[i].id = i;
+    for (int i = 0; i < cfg.connections; i++) {
+        Conn c;
+        c.fd = open_conn();
+        if (c.fd < 0) {
+            fprintf(stderr, "cannot connect to %s:%s\n", cfg.host, cfg.port);
+            return 1;
+        }
+        c.rng = 12345u + (unsigned)i;
+        workers[i % cfg.threads].conns.push_back(c);
+    }
+
+    run_start = now_ns();
+    run_end = run_start + (uint64_t)(cfg.seconds * 1e9);
+    if (cfg.rate > 0) {
+        // Each connection gets an equal share of the rate, staggered so sends do not bunch up
+        double gap = 1e9 / cfg.rate;
+        int k = 0;
+        for (int t = 0; t < cfg.threads; t++) {
+            for (Conn &c : workers[t].conns) {
+                c.interval = (uint64_t)(gap * cfg.connections);
+                if (c.interval == 0) c.interval = 1;
+                c.next_send = run_start + (uint64_t)(gap * k++);
+            }
+        }
+    }
+
+    for (int i = 0; i < cfg.threads; i++) {
+        pthread_create(&workers[i].tid, NULL, worker_main, &workers[i]);
+    }
+    Histogram all;
+    uint64_t completed = 0, errors = 0, unfinished = 0, op_counts[NUM_OPS + 1] = {};
+    for (int i = 0; i < cfg.threads; i++) {
+        pthread_join(workers[i].tid, NULL);
+        hist_merge(all, workers[i].hist);
+        completed += workers[i].completed;
+        errors += workers[i].errors;
+        unfinished += workers[i].unfinished;
+        for (int op = 1; op <= NUM_OPS; op++) op_counts[op] += workers[i].op_counts[op];
+    }
+    double elapsed = (double)(now_ns() - run_start) / 1e9;
+    if (elapsed < cfg.seconds) elapsed = cfg.seconds;
+
+    const char *correction = cfg.rate > 0 ? "scheduled_start" : cfg.expected_interval_ns ? "expected_interval" : "none";
+    printf("{\n");
+    printf("  \"target\": \"%s\",\n", cfg.target == TARGET_RPC ? "rpc" : "echo");
+    printf("  \"server\": \"%s:%s\",\n", cfg.host, cfg.port);
+    printf("  \"mode\": \"%s\",\n", cfg.rate > 0 ? "open" : "closed");
+    printf("  \"offered_rate\": %.0f,\n", cfg.rate);
+    printf("  \"connections\": %d,\n", cfg.connections);
+    printf("  \"threads\": %d,\n", cfg.threads);
+    printf("  \"depth\": %d,\n", cfg.depth);
+    printf("  \"duration_s\": %.3f,\n", elapsed);
+    printf("  \"requests\": %llu,\n", (unsigned long long)completed);
+    printf("  \"errors\": %llu,\n", (unsigned long long)errors);
+    printf("  \"unfinished\": %llu,\n", (unsigned long long)unfinished);
+    printf("  \"throughput_rps\": %.1f,\n", (double)completed / elapsed);
+    printf("  \"coordinated_omission_correction\": \"%s\",\n", correction);
+    printf("  \"latency_us\": {\"samples\": %llu, \"min\": %.1f, \"mean\": %.1f, \"p50\": %.1f, "
+           "\"p90\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f}",
+           (unsigned long long)all.total, all.total ? all.min / 1e3 : 0.0,
+           all.total ? all.sum / (double)all.total / 1e3 : 0.0, hist_percentile(all, 50) / 1e3,
+           hist_percentile(all, 90) / 1e3, hist_percentile(all, 99) / 1e3, hist_percentile(all, 99.9) / 1e3,
+           all.max / 1e3);
+    if (cfg.target == TARGET_RPC) {
+        printf(",\n  \"mix\": {");
+        for (int op = 1; op <= NUM_OPS; op++) {
+            printf("%s\"%s\": %llu", op > 1 ? ", " : "", op_names[op], (unsigned long long)op_counts[op]);
+        }
+        printf("}");
+    }
+    printf("\n}\n");
+    return errors > 0 || unfinished > 0 ? 2 : 0;
+}
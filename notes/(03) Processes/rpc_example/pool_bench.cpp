@@ -0,0 +1,88 @@
+// Benchmark: calls/sec through an RpcPool versus opening a new connection for every call.
+// Start rpc_server first, then: ./pool_bench [threads] [calls_per_thread] [max_conns]
+#include "rpc_client.hpp"
+#include "rpc_pool.hpp"
+#include "rpc_protocol.hpp"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define CONNECT_CALLS_CAP 2000 // connect-per-call leaves TIME_WAIT sockets; keep it bounded
+
+static RpcPool pool;
+static int calls_per_thread;
+static int connect_calls;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Every call borrows a pooled connection
+static void* pool_worker(void*) {
+    long errors = 0;
+    long long result;
+    for (int i = 0; i < calls_per_thread; i++) {
+        if (!rpc_pool_call(pool, RPC_OP_ADD, i, 1, result) || result != i + 1) errors++;
+    }
+    return (void*)errors;
+}
+
+// Every call pays socket() + connect() + the protocol handshake + close()
+static void* connect_worker(void*) {
+    long errors = 0;
+    long long result;
+    for (int i = 0; i < connect_calls; i++) {
+        RpcClient c;
+        if (!rpc_connect(c, "127.0.0.1", 8080) || !rpc_add(c, i, 1, result) || result != i + 1) errors++;
+        rpc_close(c);
+    }
+    return (void*)errors;
+}
+
+static double run(int nthreads, void* (*fn)(void*), long total_calls) {
+    pthread_t tids[256];
+    double start = now_sec();
+    for (int i = 0; i < nthreads; i++) {
+        pthread_create(&tids[i], NULL, fn, NULL);
+    }
+    long errors = 0;
+    for (int i = 0; i < nthreads; i++) {
+        void* e;
+        pthread_join(tids[i], &e);
+        errors += (long)e;
+    }
+    double elapsed = now_sec() - start;
+    if (errors > 0) {
+        fprintf(stderr, "%ld calls failed\n", errors);
+    }
+    return total_calls / elapsed;
+}
+
+int main(int argc, char** argv) {
+    int nthreads = (argc > 1) ? atoi(argv[1]) : 8;
+    calls_per_thread = (argc > 2) ? atoi(argv[2]) : 20000;
+    int max_conns = (argc > 3) ? atoi(argv[3]) : 4;
+    if (nthreads < 1 || nthreads > 256 || calls_per_thread < 1 || max_conns < 1) {
+        fprintf(stderr, "Usage: %s [threads 1..256] [calls_per_thread] [max_conns]\n", argv[0]);
+        return 1;
+    }
+    connect_calls = calls_per_thread < CONNECT_CALLS_CAP ? calls_per_thread : CONNECT_CALLS_CAP;
+
+    if (!rpc_pool_init(pool, "127.0.0.1", 8080, (size_t)max_conns, (size_t)max_conns)) {
+        fprintf(stderr, "cannot connect to RPC server at 127.0.0.1:8080\n");
+        return 1;
+    }
+
+    printf("%d threads sharing %d pooled connections\n", nthreads, max_conns);
+    double pooled = run(nthreads, pool_worker, (long)nthreads * calls_per_thread);
+    printf("pooled:           %10.0f calls/sec\n", pooled);
+    double per_call = run(nthreads, connect_worker, (long)nthreads * connect_calls);
+    printf("connect-per-call: %10.0f calls/sec\n", per_call);
+    printf("speedup:          %10.1fx\n", pooled / per_call);
+
+    rpc_pool_destroy(pool);
+    return 0;
+}
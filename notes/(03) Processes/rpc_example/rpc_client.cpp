@@ -1,37 +1,85 @@
 #include "rpc_client.hpp"
+#include "rpc_protocol.hpp"
+#include "../shm_example/shm_ring.hpp"
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-// Generic RPC call function that handles communication with the server
-static bool call_rpc(int fd, const char* name, long long a, long long b, long long& out) {
-    // Format request as "PROC_NAME a b" (server expects procedure name + arguments)
-    char req[64];
-    snprintf(req, sizeof(req), "%s %lld %lld", name, a, b);
-    
-    // Send request to server
-    if (write(fd, req, strlen(req)) < 0) {
-        return false; // Failed to send request
-    }
-    
-    // Read response from server
-    char buf[1024];
-    ssize_t r = read(fd, buf, sizeof(buf) - 1);
-    if (r <= 0) {
-        return false; // Failed to read response or connection closed
+#define RPC_READ_CHUNK 65536  // bytes requested per read() while collecting replies
+#define RPC_DEFAULT_PORT 8080
+#define RPC_UDP_TIMEOUT_MS 20  // udp: first wait for a reply before sending the requests again
+#define RPC_UDP_RETRIES 6  // ...doubling the wait each time: about 1.3 s in total
+
+// Procedure names for the text protocol, indexed by opcode
+static const char* const op_names[] = {"quit", "add", "sub", "mul", "div", "neg", "muladd"};
+
+// Write every iovec, retrying short writes (writev may stop in the middle of an entry).
+// MSG_NOSIGNAL: a server that went away must show up as an error here rather than kill the
+// caller with SIGPIPE.
+static bool writev_all(int fd, struct iovec* iov, int cnt) {
+    while (cnt > 0) {
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)cnt;
+        ssize_t w = sendmsg(fd, &msg, MSG_NOSIGNAL); // writev() with MSG_NOSIGNAL
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        while (cnt > 0 && (size_t)w >= iov->iov_len) {
+            w -= (ssize_t)iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base = (char*)iov->iov_base + w;
+            iov->iov_len -= (size_t)w;
+        }
     }
-    
-    buf[r] = '\0'; // null-terminate the response
-    
-    // Parse response: expect "OK result_value"
-    return sscanf(buf, "OK %lld", &out) == 1;
+    return true;
 }
 
-// Connect to RPC server at specified IP and port
-bool rpc_connect(RpcClient& c, const char* ip, uint16_t port) {
+// ---------------------------------------------------------------------------------------
+// Transports
+// ---------------------------------------------------------------------------------------
+
+// A transport only moves bytes. Framing, pipelining and the HELLO negotiation work the same
+// over all of them, and rpc_connect() picks one by the scheme in front of the address.
+struct RpcTransport {
+    const char* scheme;
+    bool negotiate;  // starts with the HELLO line; false: binary frames from the start
+    bool (*open)(RpcClient& c, const char* where);  // where: the address after "scheme:"
+    bool (*send)(RpcClient& c, struct iovec* iov, int cnt);
+    ssize_t (*recv)(RpcClient& c, char* buf, size_t cap);  // like read(): 0 at EOF, -1 on error
+    void (*close)(RpcClient& c);
+};
+
+// tcp: and unix: are both stream sockets and differ only in how they connect
+
+static bool sock_send(RpcClient& c, struct iovec* iov, int cnt) {
+    return writev_all(c.fd, iov, cnt);
+}
+
+static ssize_t sock_recv(RpcClient& c, char* buf, size_t cap) {
+    ssize_t r;
+    do {
+        r = read(c.fd, buf, cap);
+    } while (r < 0 && errno == EINTR);
+    return r;
+}
+
+static void sock_close(RpcClient& c) {
+    close(c.fd);
+}
+
+static bool tcp_connect(RpcClient& c, const char* ip, uint16_t port) {
     // Create TCP socket
     c.fd = ::socket(AF_INET, SOCK_STREAM, 0);
     if (c.fd < 0) {
@@ -45,40 +93,654 @@ bool rpc_connect(RpcClient& c, const char* ip, uint16_t port) {
     
     // Convert IP address from text to binary format
     if (inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
+        close(c.fd);
+        c.fd = -1;
         return false; // Invalid IP address
     }
     
     // Attempt to connect to the server
-    return ::connect(c.fd, (sockaddr*)&addr, sizeof(addr)) == 0;
+    if (::connect(c.fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    return true;
+}
+
+// Split "IP[:PORT]" into ip (64 bytes) and port
+static bool parse_ip_port(const char* where, char* ip, uint16_t& port) {
+    snprintf(ip, 64, "%s", where);
+    port = RPC_DEFAULT_PORT;
+    char* colon = strchr(ip, ':');
+    if (colon != NULL) {
+        *colon = '\0';
+        port = (uint16_t)atoi(colon + 1);
+    }
+    return port != 0;
+}
+
+// tcp:IP[:PORT]
+static bool tcp_open(RpcClient& c, const char* where) {
+    char ip[64];
+    uint16_t port;
+    return parse_ip_port(where, ip, port) && tcp_connect(c, ip, port);
+}
+
+// unix:PATH
+static bool unix_open(RpcClient& c, const char* path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+    c.fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        return false;
+    }
+    if (::connect(c.fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    return true;
+}
+
+// shm:NAME. Requests and replies travel through two shared-memory rings, and a side waiting
+// for the other sleeps on a futex in the ring, so a call costs no socket system calls at all.
+// See rpc_protocol.hpp for how the rings are set up.
+struct RpcShmChannel {
+    ShmRing requests;  // we produce, the server consumes
+    ShmRing replies;  // the server produces, we consume
+};
+
+// Receive the two ring memfds the server sends right after accepting
+static bool recv_ring_fds(int sock, int fds[2]) {
+    char byte;
+    struct iovec iov = {&byte, 1};
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } u;
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof(u.buf);
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1) return false;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(2 * sizeof(int))) {
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+    return true;
+}
+
+static bool shm_open_channel(RpcClient& c, const char* name) {
+    sockaddr_un addr;
+    socklen_t len = rpc_shm_address(name, &addr);
+    if (len == 0) {
+        return false;
+    }
+    c.fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        return false;
+    }
+    int fds[2];
+    if (::connect(c.fd, (sockaddr*)&addr, len) != 0 || !recv_ring_fds(c.fd, fds)) {
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+
+    RpcShmChannel* ch = new RpcShmChannel();
+    bool ok = shm_ring_attach(ch->requests, fds[0]) && shm_ring_attach(ch->replies, fds[1]);
+    close(fds[0]);
+    close(fds[1]);
+    if (!ok) {
+        shm_ring_destroy(ch->requests);
+        shm_ring_destroy(ch->replies);
+        delete ch;
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    ch->replies.peer_fd = c.fd; // a server that went away shows up as EOF instead of a hang
+    ch->requests.peer_fd = c.fd; // ...also while we wait for room in a full request ring
+    c.shm = ch;
+    return true;
+}
+
+// Every iovec goes into the ring as one or more messages; one flush makes them all visible
+static bool shm_send(RpcClient& c, struct iovec* iov, int cnt) {
+    ShmRing& r = c.shm->requests;
+    for (int i = 0; i < cnt; i++) {
+        const char* p = (const char*)iov[i].iov_base;
+        for (size_t left = iov[i].iov_len; left > 0; ) {
+            uint32_t n = left < RPC_SHM_MAX_MESSAGE ? (uint32_t)left : RPC_SHM_MAX_MESSAGE;
+            if (!shm_ring_write(r, p, n)) return false;
+            p += n;
+            left -= n;
+        }
+    }
+    shm_ring_flush(r);
+    return true;
+}
+
+static ssize_t shm_recv(RpcClient& c, char* buf, size_t cap) {
+    size_t len;
+    long n = shm_ring_read(c.shm->replies, buf, cap, &len);
+    if (n >= 0 && len > (size_t)n) {
+        errno = EMSGSIZE; // the rest of the message is lost, so the reply stream is broken
+        return -1;
+    }
+    return n < 0 ? 0 : (ssize_t)n;
+}
+
+static void shm_close(RpcClient& c) {
+    shm_ring_close(c.shm->requests); // the server sees EOF once it has read everything
+    shm_ring_destroy(c.shm->requests);
+    shm_ring_destroy(c.shm->replies);
+    delete c.shm;
+    c.shm = nullptr;
+    close(c.fd);
+}
+
+// udp:IP[:PORT]. Whole frames are packed into datagrams, and nothing guarantees that either a
+// request or its reply arrives. The channel keeps a copy of every request frame until its reply
+// comes back, keyed by request id like the completion slots. When no reply has arrived for a
+// while, every unanswered request is sent again, and the wait doubles. A late duplicate reply
+// is dropped by complete() like any other stale reply.
+struct RpcUdpPending {
+    uint32_t id = 0;
+    bool waiting = false;
+    uint16_t len = 0;
+    char frame[RPC_MAX_FRAME];
+};
+
+struct RpcUdpChannel {
+    std::vector<RpcUdpPending> pending = std::vector<RpcUdpPending>(RPC_MAX_INFLIGHT);  // by req_id % RPC_MAX_INFLIGHT
+    uint32_t waiting = 0;  // requests without a reply
+    int timeout_ms = RPC_UDP_TIMEOUT_MS;
+    int retries = 0;
+};
+
+// Send the frames with as few datagrams, and one sendmmsg() per 64 datagrams. Each datagram
+// gathers its frames straight from frames[], so nothing is copied.
+static bool udp_transmit(int fd, struct iovec* frames, size_t n) {
+    struct mmsghdr msgs[64];
+    for (size_t i = 0; i < n; ) {
+        unsigned cnt = 0;
+        while (i < n && cnt < 64) {
+            size_t first = i, bytes = 0;
+            while (i < n && i - first < IOV_MAX && bytes + frames[i].iov_len <= RPC_UDP_MAX_DATAGRAM) {
+                bytes += frames[i++].iov_len;
+            }
+            memset(&msgs[cnt], 0, sizeof(msgs[cnt]));
+            msgs[cnt].msg_hdr.msg_iov = frames + first;
+            msgs[cnt].msg_hdr.msg_iovlen = i - first;
+            cnt++;
+        }
+        for (unsigned sent = 0; sent < cnt; ) {
+            int k = sendmmsg(fd, msgs + sent, cnt - sent, 0);
+            if (k < 0 && errno == EINTR) continue;
+            if (k < 0 && errno == ECONNREFUSED) break; // server not up (yet): retried on timeout
+            if (k <= 0) return false;
+            sent += (unsigned)k;
+        }
+    }
+    return true;
+}
+
+static bool udp_open(RpcClient& c, const char* where) {
+    char ip[64];
+    uint16_t port;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    if (!parse_ip_port(where, ip, port) || inet_pton(AF_INET, ip, &addr.sin_addr) <= 0) {
+        return false;
+    }
+    addr.sin_port = htons(port);
+    // connect(): plain send()/recv() from now on, and only the server's datagrams are received
+    c.fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (c.fd < 0) {
+        return false;
+    }
+    if (::connect(c.fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(c.fd);
+        c.fd = -1;
+        return false;
+    }
+    c.udp = new RpcUdpChannel();
+    return true;
+}
+
+// Remember every request frame for retransmission, then send them
+static bool udp_send(RpcClient& c, struct iovec* iov, int cnt) {
+    std::vector<struct iovec> frames;
+    for (int i = 0; i < cnt; i++) {
+        const char* p = (const char*)iov[i].iov_base;
+        for (size_t off = 0; off < iov[i].iov_len; ) {
+            RpcFrame f;
+            int n = rpc_parse_frame(p + off, iov[i].iov_len - off, &f);
+            if (n <= 0) return false; // only whole binary frames fit in datagrams
+            off += (size_t)n;
+            if (f.opcode == RPC_OP_QUIT) continue; // nothing to tell a connectionless server
+
+            RpcUdpPending& pe = c.udp->pending[f.req_id % RPC_MAX_INFLIGHT];
+            if (!pe.waiting) c.udp->waiting++;
+            pe.id = f.req_id;
+            pe.waiting = true;
+            pe.len = (uint16_t)n;
+            memcpy(pe.frame, p + off - (size_t)n, (size_t)n);
+            frames.push_back({pe.frame, (size_t)n});
+        }
+    }
+    return udp_transmit(c.fd, frames.data(), frames.size());
+}
+
+// Receive one reply datagram, sending unanswered requests again each time the wait runs out
+static ssize_t udp_recv(RpcClient& c, char* buf, size_t cap) {
+    RpcUdpChannel* ch = c.udp;
+    for (;;) {
+        struct pollfd p = {c.fd, POLLIN, 0};
+        int r = poll(&p, 1, ch->timeout_ms);
+        if (r < 0 && errno == EINTR) continue;
+        if (r == 0) {
+            if (++ch->retries > RPC_UDP_RETRIES) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            ch->timeout_ms *= 2;
+            std::vector<struct iovec> frames;
+            for (RpcUdpPending& pe : ch->pending) {
+                if (pe.waiting) frames.push_back({pe.frame, pe.len});
+            }
+            if (!udp_transmit(c.fd, frames.data(), frames.size())) return -1;
+            continue;
+        }
+
+        ssize_t n = recv(c.fd, buf, cap, 0);
+        if (n < 0 && (errno == EINTR || errno == ECONNREFUSED)) continue; // refused: server restarting?
+        if (n <= 0) return -1;
+
+        // Answered requests no longer need a copy
+        RpcFrame f;
+        for (ssize_t off = 0, k; off < n && (k = rpc_parse_frame(buf + off, (size_t)(n - off), &f)) > 0; off += k) {
+            RpcUdpPending& pe = ch->pending[f.req_id % RPC_MAX_INFLIGHT];
+            if (pe.waiting && pe.id == f.req_id) {
+                pe.waiting = false;
+                ch->waiting--;
+            }
+        }
+        ch->retries = 0;
+        ch->timeout_ms = RPC_UDP_TIMEOUT_MS;
+        return n;
+    }
+}
+
+static void udp_close(RpcClient& c) {
+    delete c.udp;
+    c.udp = nullptr;
+    close(c.fd);
+}
+
+// The first entry is also used for addresses without a scheme
+static const RpcTransport transports[] = {
+    {"tcp", true, tcp_open, sock_send, sock_recv, sock_close},
+    {"unix", true, unix_open, sock_send, sock_recv, sock_close},
+    {"shm", true, shm_open_channel, shm_send, shm_recv, shm_close},
+    {"udp", false, udp_open, udp_send, udp_recv, udp_close},
+};
+
+static bool send_all(RpcClient& c, const char* p, size_t n) {
+    struct iovec iov = {(void*)p, n};
+    return c.transport->send(c, &iov, 1);
+}
+
+// Read one '\n'-terminated reply line into buf (null-terminated)
+static bool read_line(RpcClient& c, char* buf, size_t cap) {
+    size_t used = 0;
+    while (used == 0 || buf[used - 1] != '\n') {
+        if (used == cap - 1) return false; // reply too long
+        ssize_t r = c.transport->recv(c, buf + used, cap - 1 - used);
+        if (r <= 0) {
+            return false; // Failed to read response or connection closed
+        }
+        used += (size_t)r;
+    }
+    buf[used] = '\0'; // null-terminate the response
+    return true;
+}
+
+// Encode the request into out (RPC_MAX_FRAME bytes); returns its length (0 if it does not fit)
+static size_t encode_request(const RpcClient& c, char* out, uint16_t opcode, uint32_t id,
+                             const long long* args, uint16_t argc) {
+    if (argc > RPC_MAX_ARGS) {
+        return 0;
+    }
+    if (c.binary) {
+        int64_t wire[RPC_MAX_ARGS];
+        for (uint16_t i = 0; i < argc; i++) wire[i] = args[i];
+        return rpc_encode_frame(out, opcode, id, wire, argc);
+    }
+    if (opcode >= sizeof(op_names) / sizeof(op_names[0])) {
+        return 0;
+    }
+    // Format request as "PROC_NAME arg1 ... argN\n" (server expects procedure name + arguments, one per line)
+    int len = snprintf(out, RPC_MAX_FRAME, "%s", op_names[opcode]);
+    for (uint16_t i = 0; i < argc && len < RPC_MAX_FRAME; i++) {
+        len += snprintf(out + len, RPC_MAX_FRAME - (size_t)len, " %lld", args[i]);
+    }
+    if (len + 1 >= RPC_MAX_FRAME) {
+        return 0;
+    }
+    out[len++] = '\n';
+    return (size_t)len;
+}
+
+// The slot of `id` is free once the call that used it before (id - RPC_MAX_INFLIGHT) has been
+// collected: rpc_wait() then hands it on by storing `id`. A call still outstanding keeps it busy.
+static bool slot_free(const RpcClient& c, uint32_t id) {
+    return c.slots[id % RPC_MAX_INFLIGHT].id == id;
+}
+
+// Record a reply in its completion slot. Replies for ids we are not waiting on are dropped.
+static void complete(RpcClient& c, uint32_t id, uint16_t status, long long value) {
+    RpcSlot& s = c.slots[id % RPC_MAX_INFLIGHT];
+    if (s.id == id && !s.done) {
+        s.done = true;
+        s.status = status;
+        s.value = value;
+    }
+}
+
+// Parse every complete reply in recvbuf. Returns false if the stream is corrupt.
+static bool parse_replies(RpcClient& c) {
+    while (c.recv_off < c.recvbuf.size()) {
+        const char* p = c.recvbuf.data() + c.recv_off;
+        size_t avail = c.recvbuf.size() - c.recv_off;
+
+        if (c.binary) {
+            RpcFrame f;
+            int n = rpc_parse_frame(p, avail, &f);
+            if (n < 0) return false;
+            if (n == 0) break;
+            complete(c, f.req_id, f.opcode, f.argc == 1 ? rpc_frame_arg(&f, 0) : 0);
+            c.recv_off += (size_t)n;
+        } else {
+            // Text replies carry no id: the k-th line answers the k-th request
+            const char* nl = (const char*)memchr(p, '\n', avail);
+            if (nl == NULL) break;
+            long long v = 0;
+            uint16_t status = RPC_OK;
+            if (sscanf(p, "OK %lld", &v) != 1) {
+                status = strncmp(p, "ERR divide_by_zero", 18) == 0 ? RPC_ERR_DIVIDE_BY_ZERO
+                         : strncmp(p, "ERR overflow", 12) == 0     ? RPC_ERR_OVERFLOW
+                                                                   : RPC_ERR_EXEC_FAILED;
+            }
+            complete(c, c.next_reply_id++, status, v);
+            c.recv_off += (size_t)(nl - p) + 1;
+        }
+    }
+
+    // Compact: drop parsed bytes so the buffer does not grow without bound
+    if (c.recv_off == c.recvbuf.size()) {
+        c.recvbuf.clear();
+        c.recv_off = 0;
+    } else if (c.recv_off > RPC_READ_CHUNK) {
+        c.recvbuf.erase(c.recvbuf.begin(), c.recvbuf.begin() + (long)c.recv_off);
+        c.recv_off = 0;
+    }
+    return true;
+}
+
+// One read() of up to RPC_READ_CHUNK bytes, then parse whatever replies it completed
+static bool receive_replies(RpcClient& c) {
+    size_t old = c.recvbuf.size();
+    c.recvbuf.resize(old + RPC_READ_CHUNK);
+    ssize_t r = c.transport->recv(c, c.recvbuf.data() + old, RPC_READ_CHUNK);
+    c.recvbuf.resize(old + (r > 0 ? (size_t)r : 0));
+    if (r <= 0 || !parse_replies(c)) {
+        c.broken = true;
+        return false; // Failed to read response or connection closed
+    }
+    return true;
+}
+
+bool rpc_call_async(RpcClient& c, uint16_t opcode, const long long* args, uint16_t argc, uint32_t& req_id) {
+    uint32_t id = c.next_id;
+    if (c.fd < 0 || c.inflight >= RPC_MAX_INFLIGHT || !slot_free(c, id)) {
+        return false;
+    }
+
+    size_t old = c.sendbuf.size();
+    c.sendbuf.resize(old + RPC_MAX_FRAME);
+    size_t len = encode_request(c, c.sendbuf.data() + old, opcode, id, args, argc);
+    c.sendbuf.resize(old + len);
+    if (len == 0) {
+        return false;
+    }
+
+    RpcSlot& s = c.slots[id % RPC_MAX_INFLIGHT];
+    s.id = id;
+    s.done = false;
+    c.next_id++;
+    c.inflight++;
+    req_id = id;
+    return true;
+}
+
+bool rpc_call_async(RpcClient& c, uint16_t opcode, long long a, long long b, uint32_t& req_id) {
+    long long args[2] = {a, b};
+    return rpc_call_async(c, opcode, args, 2, req_id);
+}
+
+bool rpc_flush(RpcClient& c) {
+    if (c.sendbuf.empty()) {
+        return true;
+    }
+    bool ok = send_all(c, c.sendbuf.data(), c.sendbuf.size());
+    c.sendbuf.clear();
+    if (!ok) {
+        c.broken = true;
+    }
+    return ok;
+}
+
+bool rpc_wait(RpcClient& c, uint32_t req_id, long long& out) {
+    RpcSlot& s = c.slots[req_id % RPC_MAX_INFLIGHT];
+    // Outstanding: one of the last RPC_MAX_INFLIGHT ids issued, and its slot not yet handed on
+    if (s.id != req_id || c.next_id - req_id - 1 >= RPC_MAX_INFLIGHT) {
+        return false; // not an outstanding call
+    }
+    if (!rpc_flush(c)) {
+        return false;
+    }
+    while (!s.done) {
+        if (!receive_replies(c)) {
+            return false;
+        }
+    }
+
+    s.id = req_id + RPC_MAX_INFLIGHT; // free the slot: a stale reply can no longer match it
+    c.inflight--;
+    if (s.status != RPC_OK) {
+        return false; // server reported an error (e.g. RPC_ERR_DIVIDE_BY_ZERO)
+    }
+    out = s.value;
+    return true;
+}
+
+bool rpc_batch(RpcClient& c, RpcCall* calls, size_t n) {
+    if (c.fd < 0 || !rpc_flush(c)) {
+        return false;
+    }
+
+    // Send in chunks that fit both the in-flight window and one writev() call
+    size_t window = RPC_MAX_INFLIGHT - c.inflight;
+    if (window > IOV_MAX) window = IOV_MAX;
+    if (window == 0) {
+        return false;
+    }
+    std::vector<char> frames(window * RPC_MAX_FRAME);
+    std::vector<struct iovec> iov(window);
+    std::vector<size_t> sent(window);  // index in calls[] of each request in the chunk
+
+    for (size_t done = 0; done < n; ) {
+        size_t cnt = n - done < window ? n - done : window;
+        uint32_t first = c.next_id;
+
+        // Encode every request of the chunk into its own slice and point an iovec at it. A call
+        // that cannot be encoded (e.g. an opcode the text protocol lacks) fails on its own.
+        int nsent = 0;
+        for (size_t i = 0; i < cnt; i++) {
+            RpcCall& call = calls[done + i];
+            if (!slot_free(c, first + (uint32_t)nsent)) {
+                call.ok = false; // an rpc_call_async() still holds this slot
+                continue;
+            }
+            char* p = frames.data() + (size_t)nsent * RPC_MAX_FRAME;
+            long long args[2] = {call.a, call.b};
+            size_t len = encode_request(c, p, call.opcode, first + (uint32_t)nsent, args, 2);
+            if (len == 0) {
+                call.ok = false;
+                continue;
+            }
+            iov[(size_t)nsent] = {p, len};
+            sent[(size_t)nsent] = done + i;
+            RpcSlot& s = c.slots[(first + (uint32_t)nsent) % RPC_MAX_INFLIGHT];
+            s.id = first + (uint32_t)nsent;
+            s.done = false;
+            nsent++;
+        }
+        done += cnt;
+        if (nsent == 0) {
+            continue;
+        }
+        c.next_id += (uint32_t)nsent;
+        c.inflight += (uint32_t)nsent;
+        if (!c.transport->send(c, iov.data(), nsent)) {
+            c.broken = true;
+            return false;
+        }
+
+        // Collect the chunk's replies; each read() typically completes many of them
+        for (int i = 0; i < nsent; i++) {
+            RpcCall& call = calls[sent[(size_t)i]];
+            RpcSlot& s = c.slots[(first + (uint32_t)i) % RPC_MAX_INFLIGHT];
+            while (!s.done) {
+                if (!receive_replies(c)) {
+                    return false;
+                }
+            }
+            call.ok = rpc_wait(c, first + (uint32_t)i, call.result);
+        }
+    }
+    return true;
+}
+
+// Connected: reset the per-connection state and negotiate the protocol
+static bool start_session(RpcClient& c) {
+    // Fresh pipelining state for this connection
+    c.broken = false;
+    c.next_id = 0;
+    c.next_reply_id = 0;
+    c.inflight = 0;
+    c.sendbuf.clear();
+    c.recvbuf.clear();
+    c.recv_off = 0;
+    c.slots.assign(RPC_MAX_INFLIGHT, RpcSlot());
+    for (uint32_t i = 0; i < RPC_MAX_INFLIGHT; i++) {
+        c.slots[i].id = i; // free for the first call that maps to it
+        c.slots[i].done = true; // no reply is recorded until a call claims it
+    }
+
+    // Negotiate the binary protocol. A server that only speaks text answers "ERR ...",
+    // in which case we stay on text.
+    c.binary = !c.transport->negotiate;
+    if (c.binary) {
+        return true;
+    }
+    if (c.prefer_binary) {
+        char buf[64];
+        if (!send_all(c, RPC_HELLO_LINE, strlen(RPC_HELLO_LINE)) || !read_line(c, buf, sizeof(buf))) {
+            c.transport->close(c);
+            c.fd = -1;
+            return false;
+        }
+        c.binary = strcmp(buf, RPC_HELLO_REPLY) == 0;
+    }
+    return true;
+}
+
+// Connect to RPC server at specified IP and port
+bool rpc_connect(RpcClient& c, const char* ip, uint16_t port) {
+    if (!tcp_connect(c, ip, port)) {
+        return false;
+    }
+    c.transport = &transports[0];
+    return start_session(c);
+}
+
+// Connect to "scheme:address" (see rpc_client.hpp)
+bool rpc_connect(RpcClient& c, const char* address) {
+    const RpcTransport* t = &transports[0];
+    const char* where = address;
+    for (const RpcTransport& cand : transports) {
+        size_t n = strlen(cand.scheme);
+        if (strncmp(address, cand.scheme, n) == 0 && address[n] == ':') {
+            t = &cand;
+            where = address + n + 1;
+        }
+    }
+    if (!t->open(c, where)) {
+        return false;
+    }
+    c.transport = t;
+    return start_session(c);
 }
 
 // Close RPC connection and send quit signal to server
 void rpc_close(RpcClient& c) {
     if (c.fd >= 0) {
-        // Send quit signal to server
-        write(c.fd, "quit\n", 5);
+        // Send quit signal to server (after anything still queued by rpc_call_async)
+        if (c.binary) {
+            char frame[RPC_HEADER_SIZE];
+            size_t len = rpc_encode_frame(frame, RPC_OP_QUIT, c.next_id++, NULL, 0);
+            c.sendbuf.insert(c.sendbuf.end(), frame, frame + len);
+        } else {
+            c.sendbuf.insert(c.sendbuf.end(), "quit\n", "quit\n" + 5);
+        }
+        rpc_flush(c);
         
-        // Close socket and invalidate file descriptor
-        close(c.fd);
+        // Close the connection and invalidate file descriptor
+        c.transport->close(c);
         c.fd = -1;
     }
 }
 
+// Synchronous call: queue one request, then wait for its reply
+static bool call_rpc(RpcClient& c, uint16_t opcode, long long a, long long b, long long& out) {
+    uint32_t id;
+    return rpc_call_async(c, opcode, a, b, id) && rpc_wait(c, id, out);
+}
+
 // RPC wrapper functions for arithmetic operations
-// Each function calls the generic call_rpc with the appropriate procedure name
+// Each function calls the generic call_rpc with the appropriate procedure opcode
 
 bool rpc_add(RpcClient& c, long long a, long long b, long long& out) { 
-    return call_rpc(c.fd, "add", a, b, out); 
+    return call_rpc(c, RPC_OP_ADD, a, b, out); 
 }
 
 bool rpc_sub(RpcClient& c, long long a, long long b, long long& out) { 
-    return call_rpc(c.fd, "sub", a, b, out); 
+    return call_rpc(c, RPC_OP_SUB, a, b, out); 
 }
 
 bool rpc_mul(RpcClient& c, long long a, long long b, long long& out) { 
-    return call_rpc(c.fd, "mul", a, b, out); 
+    return call_rpc(c, RPC_OP_MUL, a, b, out); 
 }
 
 bool rpc_div(RpcClient& c, long long a, long long b, long long& out) { 
-    return call_rpc(c.fd, "div", a, b, out); 
+    return call_rpc(c, RPC_OP_DIV, a, b, out); 
 }
@@ -1,18 +1,76 @@
 #pragma once
 
-// Forward declaration for uint16_t
-typedef unsigned short uint16_t;
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define RPC_MAX_INFLIGHT 1024  // calls that may be outstanding on one connection
+
+// Completion slot for one outstanding call, indexed by req_id % RPC_MAX_INFLIGHT
+struct RpcSlot {
+    uint32_t id = 0;
+    bool done = false;
+    uint16_t status = 0;  // RpcStatus from rpc_protocol.hpp
+    long long value = 0;
+};
+
+struct RpcTransport;  // how bytes reach the server: TCP, UDP, Unix socket or shared memory (rpc_client.cpp)
+struct RpcShmChannel;  // request/response rings of a shm: connection
+struct RpcUdpChannel;  // unanswered requests of a udp: connection, kept for retransmission
 
 // RPC Client class to manage connection
 class RpcClient {
 public:
-    int fd = -1;  // socket file descriptor
+    int fd = -1;  // socket file descriptor (for shm: the socket the rings were set up over)
+    const RpcTransport* transport = nullptr;
+    RpcShmChannel* shm = nullptr;
+    RpcUdpChannel* udp = nullptr;
+    bool prefer_binary = true;  // ask the server for binary frames when connecting
+    bool binary = false;  // true once the server agreed to binary frames (see rpc_protocol.hpp)
+    bool broken = false;  // an I/O error occurred: the connection must be re-established
+    uint32_t next_id = 0;  // request id for the next call
+    uint32_t next_reply_id = 0;  // text protocol: replies come back in request order
+    uint32_t inflight = 0;  // calls issued but not yet collected with rpc_wait()
+    std::vector<char> sendbuf;  // encoded requests not yet written to the socket
+    std::vector<char> recvbuf;  // received bytes not yet parsed into replies
+    size_t recv_off = 0;  // parse position in recvbuf
+    std::vector<RpcSlot> slots;  // RPC_MAX_INFLIGHT completion slots
+};
+
+// One call in a batch: fill in opcode/a/b, rpc_batch() fills in ok/result
+struct RpcCall {
+    uint16_t opcode;  // RPC_OP_ADD, RPC_OP_SUB, ...
+    long long a;
+    long long b;
+    bool ok;
+    long long result;
 };
 
 // Function declarations for RPC operations
 bool rpc_connect(RpcClient& client, const char* ip, uint16_t port);
+// Connect to an address with a transport scheme:
+//   tcp:HOST[:PORT]   TCP, port 8080 by default (also used for an address without a scheme)
+//   unix:PATH         Unix domain stream socket
+//   shm:NAME          shared-memory rings with a futex doorbell, set up over a Unix socket
+//   udp:HOST[:PORT]   UDP datagrams, binary frames only. Unanswered requests are sent again,
+//                     so use it only for idempotent calls
+bool rpc_connect(RpcClient& client, const char* address);
 bool rpc_add(RpcClient& client, long long a, long long b, long long& result);
 bool rpc_sub(RpcClient& client, long long a, long long b, long long& result);
 bool rpc_mul(RpcClient& client, long long a, long long b, long long& result);
 bool rpc_div(RpcClient& client, long long a, long long b, long long& result);
 void rpc_close(RpcClient& client);
+
+// Pipelining: queue a call without waiting for its reply. Queued requests are written in one
+// go by rpc_flush() (or implicitly by rpc_wait()). Fails when RPC_MAX_INFLIGHT calls are
+// already outstanding.
+bool rpc_call_async(RpcClient& client, uint16_t opcode, long long a, long long b, uint32_t& req_id);
+// Same for procedures of any arity (e.g. RPC_OP_NEG takes 1 argument, RPC_OP_MULADD takes 3)
+bool rpc_call_async(RpcClient& client, uint16_t opcode, const long long* args, uint16_t argc, uint32_t& req_id);
+bool rpc_flush(RpcClient& client);
+// Block until the reply for req_id arrives. Returns false on error replies and I/O errors.
+bool rpc_wait(RpcClient& client, uint32_t req_id, long long& result);
+
+// Batching: send all n calls with writev() and collect the n replies. Returns false only on
+// I/O errors; per-call failures (e.g. division by zero) are reported in calls[i].ok.
+bool rpc_batch(RpcClient& client, RpcCall* calls, size_t n);
@@ -0,0 +1,212 @@
+#include "rpc_pool.hpp"
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Each thread is given a home shard the first time it touches the pool, round-robin, so
+// threads spread over the shard locks instead of all contending on one
+static int home_shard() {
+    static std::atomic<unsigned> next{0};
+    static thread_local int home = (int)(next.fetch_add(1) % RPC_POOL_SHARDS);
+    return home;
+}
+
+// An idle connection has nothing to say: if poll() reports anything (EOF, error, stray
+// bytes) the server closed it or the stream is out of sync, so it must not be reused
+static bool is_healthy(RpcPooledConn* conn) {
+    struct pollfd pfd = {conn->client.fd, POLLIN, 0};
+    return !conn->client.broken && poll(&pfd, 1, 0) == 0;
+}
+
+// Close a connection that is no longer counted by the pool and let a waiter open a new one
+static void drop(RpcPool& pool, RpcPooledConn* conn) {
+    rpc_close(conn->client);
+    delete conn;
+    pool.open.fetch_sub(1);
+    if (pool.waiters.load() > 0) {
+        std::lock_guard<std::mutex> g(pool.wait_lock);
+        pool.wait_cv.notify_one();
+    }
+}
+
+// Open a new pooled connection if the pool is below max_conns
+static RpcPooledConn* try_open(RpcPool& pool, int shard, bool* full) {
+    if (pool.open.fetch_add(1) >= pool.max_conns) {
+        pool.open.fetch_sub(1);
+        *full = true;
+        return NULL;
+    }
+    *full = false;
+    RpcPooledConn* conn = new RpcPooledConn();
+    conn->shard = shard;
+    if (!rpc_connect(conn->client, pool.ip, pool.port)) {
+        delete conn;
+        pool.open.fetch_sub(1);
+        return NULL;
+    }
+    return conn;
+}
+
+// Pop an idle connection, home shard first. Other shards are only try_lock()ed so a thread
+// never queues behind another shard's owners.
+static RpcPooledConn* take_idle(RpcPool& pool, int home) {
+    for (int i = 0; i < RPC_POOL_SHARDS; i++) {
+        RpcPoolShard& sh = pool.shards[(home + i) % RPC_POOL_SHARDS];
+        std::unique_lock<std::mutex> g(sh.lock, std::defer_lock);
+        if (i == 0) {
+            g.lock();
+        } else if (!g.try_lock()) {
+            continue;
+        }
+        if (!sh.idle.empty()) {
+            RpcPooledConn* conn = sh.idle.back();
+            sh.idle.pop_back();
+            return conn;
+        }
+    }
+    return NULL;
+}
+
+bool rpc_pool_init(RpcPool& pool, const char* ip, uint16_t port, size_t max_conns, size_t prewarm) {
+    snprintf(pool.ip, sizeof(pool.ip), "%s", ip);
+    pool.port = port;
+    pool.max_conns = max_conns;
+    if (prewarm > max_conns) prewarm = max_conns;
+
+    for (size_t i = 0; i < prewarm; i++) {
+        bool full;
+        int shard = (int)(i % RPC_POOL_SHARDS);
+        RpcPooledConn* conn = try_open(pool, shard, &full);
+        if (conn == NULL) {
+            rpc_pool_destroy(pool); // close the connections opened so far
+            return false;
+        }
+        conn->last_used = now_sec();
+        pool.shards[shard].idle.push_back(conn);
+    }
+    return true;
+}
+
+// Hand an idle connection to a caller, after a health check if it sat for a while (or always,
+// when the caller just saw another connection die and suspects the server restarted)
+static RpcPooledConn* checkout(RpcPool& pool, RpcPooledConn* conn, bool force_check) {
+    if ((!force_check && now_sec() - conn->last_used < pool.check_after) || is_healthy(conn)) {
+        return conn;
+    }
+    // Dead: reconnect in place so the caller never sees the stale socket
+    rpc_close(conn->client);
+    if (rpc_connect(conn->client, pool.ip, pool.port)) {
+        return conn;
+    }
+    drop(pool, conn);
+    return NULL;
+}
+
+static RpcPooledConn* acquire(RpcPool& pool, bool force_check) {
+    int home = home_shard();
+    bool full = false;
+
+    for (;;) {
+        // Fast path: reuse an idle connection
+        RpcPooledConn* conn = take_idle(pool, home);
+        if (conn != NULL) {
+            return checkout(pool, conn, force_check);
+        }
+
+        conn = try_open(pool, home, &full);
+        if (conn != NULL || !full) {
+            return conn; // new connection, or NULL because connect() failed
+        }
+
+        // Slow path: every connection is in use. Re-check under wait_lock so a release that
+        // happens between the scan and the wait cannot be missed; the timeout is a backstop.
+        pool.waiters.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> wl(pool.wait_lock);
+            conn = take_idle(pool, home);
+            if (conn == NULL && pool.open.load() >= pool.max_conns) {
+                pool.wait_cv.wait_for(wl, std::chrono::milliseconds(10));
+            }
+        }
+        pool.waiters.fetch_sub(1);
+        if (conn != NULL) {
+            return checkout(pool, conn, force_check);
+        }
+    }
+}
+
+RpcPooledConn* rpc_pool_acquire(RpcPool& pool) {
+    return acquire(pool, false);
+}
+
+void rpc_pool_release(RpcPool& pool, RpcPooledConn* conn) {
+    if (conn->client.broken || conn->client.inflight > 0) {
+        drop(pool, conn); // replies still owed on this socket would confuse the next user
+        return;
+    }
+
+    double now = now_sec();
+    conn->last_used = now;
+
+    // Push back, and evict connections at the cold end of the list that idled too long
+    std::vector<RpcPooledConn*> expired;
+    RpcPoolShard& sh = pool.shards[conn->shard];
+    {
+        std::lock_guard<std::mutex> g(sh.lock);
+        sh.idle.push_back(conn);
+        size_t n = 0;
+        while (n < sh.idle.size() && now - sh.idle[n]->last_used > pool.idle_timeout) n++;
+        if (n > 0) {
+            expired.assign(sh.idle.begin(), sh.idle.begin() + (long)n);
+            sh.idle.erase(sh.idle.begin(), sh.idle.begin() + (long)n);
+        }
+    }
+    for (RpcPooledConn* old : expired) {
+        drop(pool, old); // close() outside the shard lock
+    }
+
+    if (pool.waiters.load() > 0) {
+        std::lock_guard<std::mutex> g(pool.wait_lock);
+        pool.wait_cv.notify_one();
+    }
+}
+
+void rpc_pool_destroy(RpcPool& pool) {
+    for (RpcPoolShard& sh : pool.shards) {
+        std::vector<RpcPooledConn*> idle;
+        {
+            std::lock_guard<std::mutex> g(sh.lock);
+            idle.swap(sh.idle);
+        }
+        for (RpcPooledConn* conn : idle) {
+            drop(pool, conn);
+        }
+    }
+}
+
+bool rpc_pool_call(RpcPool& pool, uint16_t opcode, long long a, long long b, long long& result) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        RpcPooledConn* conn = acquire(pool, attempt > 0);
+        if (conn == NULL) {
+            return false;
+        }
+
+        uint32_t id;
+        bool ok = rpc_call_async(conn->client, opcode, a, b, id) && rpc_wait(conn->client, id, result);
+        bool broken = conn->client.broken;
+        rpc_pool_release(pool, conn);
+        if (ok || !broken) {
+            return ok; // success, or an error reply from the server (not worth retrying)
+        }
+        // The connection died under us (read() <= 0): the arithmetic procedures are
+        // idempotent, so retry once on a fresh connection
+    }
+    return false;
+}
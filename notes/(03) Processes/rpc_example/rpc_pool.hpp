@@ -0,0 +1,53 @@
+#pragma once
+
+#include "rpc_client.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#define RPC_POOL_SHARDS 8  // independent idle lists; each thread prefers its own
+
+// A pooled connection: an RpcClient plus bookkeeping for health checks and idle eviction
+struct RpcPooledConn {
+    RpcClient client;
+    double last_used = 0;  // CLOCK_MONOTONIC seconds when it was last released
+    int shard = 0;  // idle list it returns to
+};
+
+// One idle list with its own lock, padded so neighbouring shards do not share a cache line
+struct alignas(64) RpcPoolShard {
+    std::mutex lock;
+    std::vector<RpcPooledConn*> idle;  // LIFO: the most recently used (warmest) connection is at the back
+};
+
+// Thread-safe pool of pre-connected RpcClients shared by many application threads
+class RpcPool {
+public:
+    char ip[64] = {};
+    uint16_t port = 0;
+    size_t max_conns = 0;  // hard bound on open connections
+    double idle_timeout = 30.0;  // close connections idle longer than this (seconds)
+    double check_after = 1.0;  // health-check connections idle longer than this before reuse
+    std::atomic<size_t> open{0};  // connections currently open (idle + in use)
+    RpcPoolShard shards[RPC_POOL_SHARDS];
+
+    // Slow path only: threads waiting because all max_conns connections are in use
+    std::mutex wait_lock;
+    std::condition_variable wait_cv;
+    std::atomic<int> waiters{0};
+};
+
+// Set up the pool and open `prewarm` connections up front (spread across the shards)
+bool rpc_pool_init(RpcPool& pool, const char* ip, uint16_t port, size_t max_conns, size_t prewarm);
+// Borrow a healthy connection, opening a new one if the pool has room. Blocks while all
+// max_conns connections are in use. Returns NULL if a new connection cannot be opened.
+RpcPooledConn* rpc_pool_acquire(RpcPool& pool);
+// Give a connection back. Broken connections are closed instead of being reused.
+void rpc_pool_release(RpcPool& pool, RpcPooledConn* conn);
+// Close every idle connection (connections still borrowed are closed when released)
+void rpc_pool_destroy(RpcPool& pool);
+
+// Acquire, call, release. A call that fails because the connection broke (e.g. the server
+// restarted and read() returned 0) is retried once on a freshly opened connection.
+bool rpc_pool_call(RpcPool& pool, uint16_t opcode, long long a, long long b, long long& result);
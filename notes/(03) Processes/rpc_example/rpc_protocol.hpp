@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// Binary wire protocol shared by rpc_server.cpp and rpc_client.cpp.
+//
+// A connection starts in the text protocol ("add 5 7\n" -> "OK 12\n"). A client that wants
+// binary frames sends the line RPC_HELLO_LINE; a server that understands it answers
+// RPC_HELLO_REPLY and both sides switch to frames for the rest of the connection. An older
+// server answers "ERR ..." instead and the client keeps using text.
+//
+// Every frame is a fixed 12-byte header followed by argc signed 64-bit arguments. All fields
+// are little-endian, so on x86/ARM the load helpers below compile to plain moves.
+//
+//   offset  size  field
+//   0       4     len      total frame length in bytes, header included (12 + 8 * argc)
+//   4       2     opcode   request: procedure id (RpcOpcode); reply: status (RpcStatus)
+//   6       2     argc     request: number of arguments; reply: 1 on success, else 0
+//   8       4     req_id   chosen by the client, echoed back unchanged in the reply
+//   12      8*n   args     int64 arguments (request) or the result (reply)
+
+#define RPC_HELLO_LINE "HELLO bin1\n"
+#define RPC_HELLO_REPLY "OK bin1\n"
+
+#define RPC_HEADER_SIZE 12
+#define RPC_MAX_ARGS 16
+#define RPC_MAX_FRAME (RPC_HEADER_SIZE + 8 * RPC_MAX_ARGS)
+
+// Procedure ids carried in request frames
+enum RpcOpcode : uint16_t {
+    RPC_OP_QUIT = 0, // close the connection after flushing earlier replies
+    RPC_OP_ADD = 1,
+    RPC_OP_SUB = 2,
+    RPC_OP_MUL = 3,
+    RPC_OP_DIV = 4,
+    RPC_OP_NEG = 5, // 1 argument
+    RPC_OP_MULADD = 6, // 3 arguments: a * b + c
+};
+
+// Status codes carried in reply frames (same meaning as the text protocol's ERR strings)
+enum RpcStatus : uint16_t {
+    RPC_OK = 0,
+    RPC_ERR_INVALID_FORMAT = 1,
+    RPC_ERR_UNKNOWN_PROCEDURE = 2,
+    RPC_ERR_WRONG_ARITY = 3,
+    RPC_ERR_DIVIDE_BY_ZERO = 4,
+    RPC_ERR_EXEC_FAILED = 5,
+    RPC_ERR_OVERFLOW = 6, // the result does not fit in 64 bits
+};
+
+// Decoded view of a frame header; the arguments stay in the receive buffer
+struct RpcFrame {
+    uint32_t len;
+    uint16_t opcode;
+    uint16_t argc;
+    uint32_t req_id;
+    const char *args; // points into the buffer the frame was parsed from
+};
+
+// Little-endian loads/stores that work on unaligned buffer positions
+static inline uint16_t rpc_bswap_if_be16(uint16_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap16(v);
+#else
+    return v;
+#endif
+}
+
+static inline uint32_t rpc_bswap_if_be32(uint32_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap32(v);
+#else
+    return v;
+#endif
+}
+
+static inline uint64_t rpc_bswap_if_be64(uint64_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return __builtin_bswap64(v);
+#else
+    return v;
+#endif
+}
+
+static inline uint16_t rpc_load16(const char *p) { uint16_t v; memcpy(&v, p, 2); return rpc_bswap_if_be16(v); }
+static inline uint32_t rpc_load32(const char *p) { uint32_t v; memcpy(&v, p, 4); return rpc_bswap_if_be32(v); }
+static inline int64_t rpc_load64(const char *p) { uint64_t v; memcpy(&v, p, 8); return (int64_t)rpc_bswap_if_be64(v); }
+
+static inline void rpc_store16(char *p, uint16_t v) { v = rpc_bswap_if_be16(v); memcpy(p, &v, 2); }
+static inline void rpc_store32(char *p, uint32_t v) { v = rpc_bswap_if_be32(v); memcpy(p, &v, 4); }
+static inline void rpc_store64(char *p, int64_t v) { uint64_t u = rpc_bswap_if_be64((uint64_t)v); memcpy(p, &u, 8); }
+
+// Parse the frame starting at p without copying it.
+// Returns the frame length if a complete frame is available, 0 if more bytes are needed,
+// or -1 if the header is malformed (the connection should be dropped).
+static inline int rpc_parse_frame(const char *p, size_t avail, RpcFrame *f) {
+    if (avail < RPC_HEADER_SIZE) return 0;
+    f->len = rpc_load32(p);
+    f->opcode = rpc_load16(p + 4);
+    f->argc = rpc_load16(p + 6);
+    f->req_id = rpc_load32(p + 8);
+    if (f->argc > RPC_MAX_ARGS || f->len != RPC_HEADER_SIZE + 8u * f->argc) return -1;
+    if (avail < f->len) return 0;
+    f->args = p + RPC_HEADER_SIZE;
+    return (int)f->len;
+}
+
+static inline int64_t rpc_frame_arg(const RpcFrame *f, int i) {
+    return rpc_load64(f->args + 8 * i);
+}
+
+// Encode a frame into out (which must hold RPC_HEADER_SIZE + 8 * argc bytes); returns its length
+static inline size_t rpc_encode_frame(char *out, uint16_t opcode, uint32_t req_id,
+                                      const int64_t *args, uint16_t argc) {
+    size_t len = RPC_HEADER_SIZE + 8u * argc;
+    rpc_store32(out, (uint32_t)len);
+    rpc_store16(out + 4, opcode);
+    rpc_store16(out + 6, argc);
+    rpc_store32(out + 8, req_id);
+    for (uint16_t i = 0; i < argc; i++) {
+        rpc_store64(out + RPC_HEADER_SIZE + 8 * i, args[i]);
+    }
+    return len;
+}
+
+// udp: transport (rpc_server.cpp -l udp). Every datagram carries one or more whole binary
+// frames; there is no HELLO line and no text protocol. The reply datagram holds one reply frame
+// per request frame, in the same order (QUIT frames are ignored). Nothing is retransmitted by
+// the server: a client that gets no reply sends the request again with the same req_id.
+#define RPC_UDP_MAX_DATAGRAM 1472 // Ethernet MTU minus IP and UDP headers: no fragmentation
+
+// shm: transport (rpc_client.cpp, rpc_server.cpp -l shm:NAME). The server listens on the
+// abstract Unix socket "\0rpc-shm.NAME". For each connection it creates two rings from
+// ../shm_example/shm_ring.hpp and sends their memfds back in one SCM_RIGHTS message: first the
+// client -> server ring, then the server -> client ring. From then on the rings carry the same
+// byte stream a TCP connection would (HELLO line, then frames), cut into messages of at most
+// RPC_SHM_MAX_MESSAGE bytes. The socket stays open so each side notices when the other goes away.
+#define RPC_SHM_RING_BYTES (256 * 1024)
+#define RPC_SHM_MAX_MESSAGE 65536
+
+// Fill in the rendezvous address for shm:name; returns its length, or 0 if name is too long
+static inline socklen_t rpc_shm_address(const char *name, struct sockaddr_un *addr) {
+    static const char prefix[] = "rpc-shm.";
+    size_t n = strlen(name);
+    if (1 + sizeof(prefix) - 1 + n > sizeof(addr->sun_path)) return 0;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path + 1, prefix, sizeof(prefix) - 1); // sun_path[0] = 0: abstract namespace
+    memcpy(addr->sun_path + sizeof(prefix), name, n);
+    return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + sizeof(prefix) + n);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+
+// Compile-time procedure registry support for rpc_server.cpp (and dispatch_bench.cpp).
+//
+// Binary requests carry an opcode, which indexes the registry array directly. Text requests
+// carry a name, which is resolved with a minimal-probe perfect hash built by the compiler:
+//
+//   bucket = hash(0, name) % N             (N buckets, one per entry on average)
+//   slot   = hash(seed[bucket], name) % T  (T = power of two >= 2N)
+//
+// build_perfect_hash() picks, per bucket, a seed that sends every name of that bucket to a
+// free slot (biggest buckets first). A lookup is therefore two hashes, one table load and a
+// single strcmp to reject names that are not registered, no matter how many procedures exist.
+
+// FNV-1a with a seed, followed by a murmur-style finalizer to spread the low bits
+constexpr uint32_t rpc_hash(uint32_t seed, std::string_view s) {
+    uint32_t h = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char ch : s) {
+        h ^= (uint8_t)ch;
+        h *= 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h;
+}
+
+constexpr size_t rpc_slot_count(size_t n) {
+    size_t t = 1;
+    while (t < 2 * n) t <<= 1;
+    return t;
+}
+
+template <size_t N>
+struct PerfectHash {
+    static constexpr size_t kSlots = rpc_slot_count(N);
+
+    uint32_t seeds[N] = {}; // per-bucket displacement seed
+    int32_t slots[kSlots] = {}; // registry index stored in each slot, -1 when empty
+    bool ok = false; // false when the keys contain duplicates
+
+    // Registry index that `name` would occupy, or -1. Names that are not registered can still
+    // land on an occupied slot, so callers compare the name of the returned entry.
+    constexpr int lookup(std::string_view name) const {
+        uint32_t bucket = rpc_hash(0, name) % N;
+        return slots[rpc_hash(seeds[bucket], name) & (kSlots - 1)];
+    }
+};
+
+// Build the hash over entries[i].name. Meant to run in a constexpr context so that the
+// tables end up in .rodata; a failure there is reported through static_assert(ph.ok).
+template <typename Entry, size_t N>
+constexpr PerfectHash<N> build_perfect_hash(const Entry (&entries)[N]) {
+    PerfectHash<N> ph{};
+    constexpr size_t T = PerfectHash<N>::kSlots;
+    for (size_t s = 0; s < T; s++) ph.slots[s] = -1;
+
+    // Group entry indices by first-level bucket (counting sort)
+    size_t start[N + 1] = {};
+    size_t members[N] = {};
+    for (size_t i = 0; i < N; i++) start[rpc_hash(0, entries[i].name) % N + 1]++;
+    size_t max_size = 0;
+    for (size_t b = 0; b < N; b++) {
+        if (start[b + 1] > max_size) max_size = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    size_t fill[N] = {};
+    for (size_t i = 0; i < N; i++) {
+        size_t b = rpc_hash(0, entries[i].name) % N;
+        members[start[b] + fill[b]++] = i;
+    }
+
+    // Place the biggest buckets first, while the table is still mostly empty
+    for (size_t size = max_size; size > 0; size--) {
+        for (size_t b = 0; b < N; b++) {
+            if (start[b + 1] - start[b] != size) continue;
+
+            for (uint32_t seed = 1;; seed++) {
+                if (seed > (1u << 20)) return ph; // only duplicate names can get here
+
+                // Claim a slot per member; on a collision give back what this seed claimed
+                size_t k = 0;
+                for (; k < size; k++) {
+                    size_t m = members[start[b] + k];
+                    size_t slot = rpc_hash(seed, entries[m].name) & (T - 1);
+                    if (ph.slots[slot] >= 0) break;
+                    ph.slots[slot] = (int32_t)m;
+                }
+                if (k == size) {
+                    ph.seeds[b] = seed;
+                    break;
+                }
+                while (k-- > 0) {
+                    ph.slots[rpc_hash(seed, entries[members[start[b] + k]].name) & (T - 1)] = -1;
+                }
+            }
+        }
+    }
+    ph.ok = true;
+    return ph;
+}
+
+// Registry index of `name`, or -1. Usable both at compile time and at run time.
+template <typename Entry, size_t N>
+constexpr int registry_find(const Entry (&entries)[N], const PerfectHash<N>& ph, std::string_view name) {
+    int idx = ph.lookup(name);
+    if (idx < 0 || std::string_view(entries[idx].name) != name) return -1;
+    return idx;
+}
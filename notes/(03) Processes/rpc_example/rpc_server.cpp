@@ -1,164 +1,1041 @@
 #include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
 #include <unistd.h>
+#include <atomic>
+
+#include "rpc_protocol.hpp"
+#include "rpc_registry.hpp"
+#include "../shm_example/shm_ring.hpp"
 
 #define PORT 8080
-#define BUFSZ 1024
+#define BUFSZ 1024 // initial size of each connection's read/write buffer
+#define MAX_LINE 1024 // longest request line we accept before dropping the client
+#define MAX_EVENTS 256 // events fetched per epoll_wait() call
+#define OUT_HIGH_WATER (256 * 1024) // stop reading a client whose replies pile up past this
+#define MAX_WORKERS 256
+#define UDP_BATCH 64 // datagrams per recvmmsg()/sendmmsg() call
+
+// Function pointer type for procedures. args holds exactly `arity` values (checked before
+// the call). Returns RPC_OK or an RpcStatus error code.
+typedef int (*proc_fn)(const long long *args, long long *out);
 
-// Function pointer type for procedures with 2 arguments
-typedef int (*proc2_fn)(long long a, long long b, long long *out);
+// Arithmetic operation implementations. Results that do not fit in a long long are reported
+// as RPC_ERR_OVERFLOW: signed overflow is undefined behavior, and LLONG_MIN / -1 raises SIGFPE,
+// which would take down the whole server.
+static int add_impl(const long long *args, long long *out) {
+    return __builtin_add_overflow(args[0], args[1], out) ? RPC_ERR_OVERFLOW : RPC_OK;
+}
 
-// Arithmetic operation implementations
-static int add_impl(long long a, long long b, long long *out) { 
-    *out = a + b; 
-    return 0; 
+static int sub_impl(const long long *args, long long *out) {
+    return __builtin_sub_overflow(args[0], args[1], out) ? RPC_ERR_OVERFLOW : RPC_OK;
 }
 
-static int sub_impl(long long a, long long b, long long *out) { 
-    *out = a - b; 
-    return 0; 
+static int mul_impl(const long long *args, long long *out) {
+    return __builtin_mul_overflow(args[0], args[1], out) ? RPC_ERR_OVERFLOW : RPC_OK;
 }
 
-static int mul_impl(long long a, long long b, long long *out) { 
-    *out = a * b; 
-    return 0; 
+static int div_impl(const long long *args, long long *out) {
+    if (args[1] == 0) return RPC_ERR_DIVIDE_BY_ZERO;
+    if (args[0] == LLONG_MIN && args[1] == -1) return RPC_ERR_OVERFLOW;
+    *out = args[0] / args[1];
+    return RPC_OK;
 }
 
-static int div_impl(long long a, long long b, long long *out) { 
-    if (b == 0) return -1; // division by zero error
-    *out = a / b; 
-    return 0; 
+static int neg_impl(const long long *args, long long *out) {
+    return __builtin_sub_overflow(0LL, args[0], out) ? RPC_ERR_OVERFLOW : RPC_OK;
+}
+
+static int muladd_impl(const long long *args, long long *out) {
+    long long product;
+    if (__builtin_mul_overflow(args[0], args[1], &product)) return RPC_ERR_OVERFLOW;
+    return __builtin_add_overflow(product, args[2], out) ? RPC_ERR_OVERFLOW : RPC_OK;
 }
 
 // Procedure structure to hold procedure information
-typedef struct {
+struct Proc {
     const char *name; // procedure name (e.g. "add", "div")
-    int arity; // number of arguments (valid when arity is 2)
-    proc2_fn fn; // function pointer to implementation
-} Proc;
+    int arity; // number of arguments (0..RPC_MAX_ARGS)
+    proc_fn fn; // function pointer to implementation
+};
 
-// Registry of available RPC procedures
-static Proc procs[] = {
+// Registry of available RPC procedures. The position in this array is the procedure's id:
+// entry i has opcode i + 1 (opcode 0 is RPC_OP_QUIT), so binary dispatch is a plain index.
+static constexpr Proc procs[] = {
     {"add", 2, add_impl},
     {"sub", 2, sub_impl},
     {"mul", 2, mul_impl},
-    {"div", 2, div_impl}
+    {"div", 2, div_impl},
+    {"neg", 1, neg_impl},
+    {"muladd", 3, muladd_impl},
+};
+static constexpr size_t NPROCS = sizeof(procs) / sizeof(procs[0]);
+
+// Name -> index perfect hash, computed by the compiler (see rpc_registry.hpp)
+static constexpr PerfectHash<NPROCS> proc_hash = build_perfect_hash(procs);
+static_assert(proc_hash.ok, "procedure names must be unique");
+
+// Resolve a procedure name to its opcode at compile time
+static constexpr uint16_t proc_opcode(std::string_view name) {
+    return (uint16_t)(registry_find(procs, proc_hash, name) + 1);
+}
+
+// The opcodes in rpc_protocol.hpp must agree with the registry order
+static_assert(proc_opcode("add") == RPC_OP_ADD, "registry order");
+static_assert(proc_opcode("sub") == RPC_OP_SUB, "registry order");
+static_assert(proc_opcode("mul") == RPC_OP_MUL, "registry order");
+static_assert(proc_opcode("div") == RPC_OP_DIV, "registry order");
+static_assert(proc_opcode("neg") == RPC_OP_NEG, "registry order");
+static_assert(proc_opcode("muladd") == RPC_OP_MULADD, "registry order");
+
+// Text requests: find a procedure by name in O(1)
+static const Proc* find_proc(const char *name) {
+    int idx = registry_find(procs, proc_hash, name);
+    return idx < 0 ? NULL : &procs[idx];
+}
+
+// Binary requests: the opcode indexes the registry directly (flat jump table)
+static const Proc* find_proc_by_opcode(uint16_t opcode) {
+    if (opcode == RPC_OP_QUIT || opcode > NPROCS) return NULL;
+    return &procs[opcode - 1];
+}
+
+// Reply text for each RpcStatus error code
+static const char *const err_lines[] = {
+    "OK\n",
+    "ERR invalid_format\n",
+    "ERR unknown_procedure\n",
+    "ERR wrong_arity\n",
+    "ERR divide_by_zero\n",
+    "ERR exec_failed\n",
+    "ERR overflow\n",
 };
 
-// Function to find a procedure by name
-static Proc* find_proc(const char *name) {
-    size_t n = sizeof(procs)/sizeof(procs[0]);
-    for (size_t i = 0; i < n; i++) {
-        if (strcmp(procs[i].name, name) == 0) {
-            return &procs[i];
+// Growable byte buffer. Data lives in [off, len); bytes before off were already consumed.
+typedef struct {
+    char *data;
+    size_t off;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+// Make room for at least `extra` more bytes at the end of the buffer
+static int buf_reserve(Buffer *b, size_t extra) {
+    if (b->off > 0 && b->len + extra > b->cap) {
+        // Slide unconsumed bytes to the front before growing
+        memmove(b->data, b->data + b->off, b->len - b->off);
+        b->len -= b->off;
+        b->off = 0;
+    }
+    if (b->len + extra <= b->cap) return 0;
+
+    size_t cap = b->cap ? b->cap : BUFSZ;
+    while (cap < b->len + extra) cap *= 2;
+    char *p = (char*)realloc(b->data, cap);
+    if (p == NULL) return -1;
+    b->data = p;
+    b->cap = cap;
+    return 0;
+}
+
+static int buf_append(Buffer *b, const char *s, size_t n) {
+    if (buf_reserve(b, n) < 0) return -1;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+    return 0;
+}
+
+// Drop consumed bytes; reset to the start when the buffer empties
+static void buf_consume(Buffer *b, size_t n) {
+    b->off += n;
+    if (b->off == b->len) b->off = b->len = 0;
+}
+
+// One event loop. With -w N there are N of these, each pinned to its own CPU and owning its
+// own SO_REUSEPORT listening socket and epoll instance, so workers never share a lock.
+typedef struct {
+    int id;
+    int cpu; // CPU this worker is pinned to, or -1 for "let the scheduler decide"
+    int sfd; // this worker's listening socket
+    int epfd; // this worker's epoll instance
+    int udp_fd; // this worker's SO_REUSEPORT UDP socket (-l udp), or -1
+    char *udp_bufs; // UDP_BATCH request buffers followed by UDP_BATCH reply buffers
+    pthread_t tid;
+    unsigned long long requests; // written only by this worker; read after it is joined
+    unsigned long long connections;
+    unsigned long long datagrams; // UDP requests received...
+    unsigned long long recv_calls; // ...by this many recvmmsg() calls
+} Worker;
+
+// Per-client state: one of these per accepted socket
+typedef struct {
+    int fd;
+    Worker *w; // event loop that owns this connection
+    Buffer in; // bytes received but not yet parsed into complete lines
+    Buffer out; // replies not yet accepted by the kernel
+    int closing; // client sent "quit" (or misbehaved): close once `out` is flushed
+    int binary; // client negotiated binary frames (rpc_protocol.hpp) instead of text lines
+    char peer[INET_ADDRSTRLEN];
+} Conn;
+
+static int stop_fd = -1; // eventfd watched by every worker; becomes readable on shutdown
+static char stop_marker; // epoll tag for stop_fd (listeners use NULL, clients their Conn*)
+
+// Local transports (-l): one listening socket each, shared by every worker. EPOLLEXCLUSIVE
+// wakes a single worker per new connection.
+static int unix_fd = -1; // -l unix:PATH
+static const char *unix_path;
+static char unix_marker; // epoll tag for unix_fd
+static int shm_fd = -1; // -l shm:NAME, the rendezvous socket of the shared-memory transport
+static char shm_marker; // epoll tag for shm_fd
+static int udp_port = -1; // -l udp[:PORT]
+static char udp_marker; // epoll tag for the worker's UDP socket
+
+// A shm: client. Its requests arrive through a futex-doorbell ring, which epoll cannot watch,
+// so each one is served by a thread of its own that sleeps on the ring.
+typedef struct ShmSession {
+    int fd; // the rendezvous connection: tells us when the client goes away
+    ShmRing requests;
+    ShmRing replies;
+    Worker stats; // only `requests` is used
+    Conn conn; // the same parsing and reply buffers as a socket client
+    struct ShmSession *next;
+} ShmSession;
+
+static pthread_mutex_t shm_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t shm_done = PTHREAD_COND_INITIALIZER; // signalled when a session ends
+static ShmSession *shm_sessions; // running sessions, under shm_lock
+static std::atomic<unsigned long long> shm_requests{0}; // requests of sessions that ended
+
+// Queue a reply line for the client
+static void send_line(Conn *c, const char *s) {
+    if (buf_append(&c->out, s, strlen(s)) < 0) {
+        c->closing = 1; // out of memory: give up on this client
+    }
+}
+
+// Parse and execute one request line, appending the reply to c->out
+static void handle_request(Conn *c, char *line) {
+    if (strcmp(line, "quit") == 0) {
+        c->closing = 1;
+        return;
+    }
+
+    // Protocol negotiation: everything after this line is binary frames
+    if (strcmp(line, "HELLO bin1") == 0) {
+        send_line(c, RPC_HELLO_REPLY);
+        c->binary = 1;
+        return;
+    }
+
+    c->w->requests++;
+
+    // Parse request: format is "PROC_NAME arg1 ... argN"
+    char *save = NULL;
+    char *proc_name = strtok_r(line, " \t", &save);
+    if (proc_name == NULL) {
+        send_line(c, err_lines[RPC_ERR_INVALID_FORMAT]);
+        return;
+    }
+
+    long long args[RPC_MAX_ARGS];
+    int argc = 0;
+    for (char *tok; (tok = strtok_r(NULL, " \t", &save)) != NULL; argc++) {
+        if (argc == RPC_MAX_ARGS) {
+            send_line(c, err_lines[RPC_ERR_WRONG_ARITY]);
+            return;
+        }
+        char *end;
+        errno = 0;
+        args[argc] = strtoll(tok, &end, 10);
+        if (*end != '\0' || errno != 0) {
+            send_line(c, err_lines[RPC_ERR_INVALID_FORMAT]);
+            return;
+        }
+    }
+
+    // Find the requested procedure
+    const Proc *p = find_proc(proc_name);
+    if (p == NULL) {
+        send_line(c, err_lines[RPC_ERR_UNKNOWN_PROCEDURE]);
+        return;
+    }
+
+    // Check arity (number of arguments)
+    if (p->arity != argc) {
+        send_line(c, err_lines[RPC_ERR_WRONG_ARITY]);
+        return;
+    }
+
+    // Execute the procedure
+    long long out = 0;
+    int rc = p->fn(args, &out);
+
+    if (rc == RPC_OK) {
+        // Success - send result
+        char reply[64];
+        snprintf(reply, sizeof(reply), "OK %lld\n", out);
+        send_line(c, reply);
+    } else {
+        // The procedure reports which error occurred (e.g. divide_by_zero)
+        send_line(c, err_lines[rc]);
+    }
+}
+
+// Queue a binary reply frame carrying a status and, on success, the result
+static void send_frame(Conn *c, uint32_t req_id, uint16_t status, long long result) {
+    if (buf_reserve(&c->out, RPC_HEADER_SIZE + 8) < 0) {
+        c->closing = 1;
+        return;
+    }
+    int64_t res = result;
+    c->out.len += rpc_encode_frame(c->out.data + c->out.len, status, req_id, &res, status == RPC_OK ? 1 : 0);
+}
+
+// Run the procedure a binary request names; returns its RpcStatus and sets *out on success
+static uint16_t execute_frame(const RpcFrame *f, long long *out) {
+    const Proc *p = find_proc_by_opcode(f->opcode);
+    if (p == NULL) return RPC_ERR_UNKNOWN_PROCEDURE;
+    if (p->arity != f->argc) return RPC_ERR_WRONG_ARITY;
+
+    // Decode the fixed-width arguments straight out of the receive buffer
+    long long args[RPC_MAX_ARGS];
+    for (int i = 0; i < p->arity; i++) {
+        args[i] = rpc_frame_arg(f, i);
+    }
+    return (uint16_t)p->fn(args, out);
+}
+
+static void handle_frame(Conn *c, const RpcFrame *f) {
+    if (f->opcode == RPC_OP_QUIT) {
+        c->closing = 1;
+        return;
+    }
+
+    c->w->requests++;
+
+    long long out = 0;
+    uint16_t rc = execute_frame(f, &out);
+    send_frame(c, f->req_id, rc, out);
+}
+
+// Run every complete frame sitting in c->in; a trailing partial frame stays buffered
+static void process_frames(Conn *c) {
+    while (!c->closing && c->in.off < c->in.len) {
+        RpcFrame f;
+        int n = rpc_parse_frame(c->in.data + c->in.off, c->in.len - c->in.off, &f);
+        if (n == 0) return; // wait for the rest of the frame
+        if (n < 0) {
+            send_frame(c, 0, RPC_ERR_INVALID_FORMAT, 0);
+            c->closing = 1; // framing is lost; nothing after this can be trusted
+            return;
+        }
+        handle_frame(c, &f);
+        buf_consume(&c->in, (size_t)n);
+    }
+}
+
+// Run every complete request sitting in c->in; a trailing partial one stays buffered
+static void process_input(Conn *c) {
+    while (!c->closing && c->in.off < c->in.len) {
+        if (c->binary) {
+            process_frames(c);
+            return;
+        }
+
+        char *start = c->in.data + c->in.off;
+        size_t avail = c->in.len - c->in.off;
+        char *nl = (char*)memchr(start, '\n', avail);
+        if (nl == NULL) {
+            if (avail > MAX_LINE) {
+                send_line(c, "ERR line_too_long\n");
+                c->closing = 1;
+            }
+            return; // wait for the rest of the line
+        }
+
+        *nl = '\0';
+        if (nl > start && nl[-1] == '\r') nl[-1] = '\0'; // tolerate telnet-style CRLF
+        handle_request(c, start);
+        buf_consume(&c->in, (size_t)(nl - start) + 1);
+    }
+}
+
+// Push as much of c->out to the socket as it will take. Returns -1 on a fatal error.
+static int flush_output(Conn *c) {
+    while (c->out.off < c->out.len) {
+        ssize_t n = write(c->fd, c->out.data + c->out.off, c->out.len - c->out.off);
+        if (n > 0) {
+            buf_consume(&c->out, (size_t)n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0; // kernel buffer full; EPOLLOUT will tell us when to resume
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Drain the socket (edge-triggered: we must read until EAGAIN) and run what arrived.
+// Every request found in one read() is executed before any reply is written, so a client
+// that pipelines N requests costs one read() and one write() rather than N of each.
+// Returns -1 when the connection should be closed.
+static int handle_readable(Conn *c, int hangup) {
+    while (!c->closing) {
+        // Back-pressure: a client that never reads its replies cannot make us buffer forever
+        if (c->out.len - c->out.off > OUT_HIGH_WATER) return 0;
+
+        if (buf_reserve(&c->in, BUFSZ) < 0) return -1;
+        ssize_t n = read(c->fd, c->in.data + c->in.len, c->in.cap - c->in.len);
+        if (n > 0) {
+            size_t wanted = c->in.cap - c->in.len;
+            c->in.len += (size_t)n;
+            process_input(c);
+            // A short read means the socket is drained; data arriving later raises a new
+            // edge, so skip the read() that would only return EAGAIN. After a hangup we
+            // keep reading to see the EOF, since no further event will report it.
+            if ((size_t)n < wanted && !hangup) return 0;
+        } else if (n == 0) {
+            // Client finished sending (it may only have half-closed): close once the
+            // replies to whatever arrived with the FIN have been flushed.
+            c->closing = 1;
+            return 0;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void close_conn(Conn *c) {
+    close(c->fd); // closing the fd also removes it from the epoll set
+    free(c->in.data);
+    free(c->out.data);
+    free(c);
+}
+
+// Accept every pending connection on a listening socket (TCP or Unix)
+static void accept_clients(Worker *w, int lfd) {
+    while (1) {
+        struct sockaddr_storage client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int cfd = accept4(lfd, (struct sockaddr*)&client_addr, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+
+        Conn *c = (Conn*)calloc(1, sizeof(Conn));
+        if (c == NULL) {
+            close(cfd);
+            continue;
+        }
+        c->fd = cfd;
+        c->w = w;
+        if (client_addr.ss_family == AF_INET) {
+            inet_ntop(AF_INET, &((struct sockaddr_in*)&client_addr)->sin_addr, c->peer, sizeof(c->peer));
+        } else {
+            strcpy(c->peer, "unix socket");
+        }
+
+        // Edge-triggered: one notification per state change, so handlers drain until EAGAIN.
+        // EPOLLOUT is registered up front to avoid an epoll_ctl() call on every partial write.
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = c;
+        if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, cfd, &ev) < 0) {
+            perror("epoll_ctl");
+            close_conn(c);
+            continue;
+        }
+
+        w->connections++;
+        printf("Client connected from %s\n", c->peer);
+    }
+}
+
+// Serve one shm: client until it hangs up (or sends quit)
+static void* shm_session_main(void *arg) {
+    ShmSession *s = (ShmSession*)arg;
+    Conn *c = &s->conn;
+    static thread_local char chunk[RPC_SHM_MAX_MESSAGE];
+
+    while (!c->closing) {
+        // Take every message already published before answering, like one read() on a socket.
+        // Clients never send more than RPC_SHM_MAX_MESSAGE at once: a longer message is an error.
+        size_t msg_len;
+        long n = shm_ring_read(s->requests, chunk, sizeof(chunk), &msg_len);
+        if (n < 0) break; // client closed the ring, went away or corrupted it
+        do {
+            if (msg_len > (size_t)n || buf_append(&c->in, chunk, (size_t)n) < 0) c->closing = 1;
+        } while (!c->closing && s->requests.head != s->requests.tail_cache &&
+                 (n = shm_ring_read(s->requests, chunk, sizeof(chunk), &msg_len)) >= 0);
+        if (c->closing) break;
+        process_input(c);
+
+        while (c->out.off < c->out.len) {
+            size_t len = c->out.len - c->out.off;
+            if (len > RPC_SHM_MAX_MESSAGE) len = RPC_SHM_MAX_MESSAGE;
+            if (!shm_ring_write(s->replies, c->out.data + c->out.off, (uint32_t)len)) {
+                c->closing = 1; // the client went away without draining its replies
+                break;
+            }
+            buf_consume(&c->out, len);
         }
+        shm_ring_flush(s->replies);
     }
+
+    shm_ring_close(s->replies);
+    shm_requests += s->stats.requests;
+    pthread_mutex_lock(&shm_lock);
+    for (ShmSession **p = &shm_sessions; *p != NULL; p = &(*p)->next) {
+        if (*p == s) {
+            *p = s->next;
+            break;
+        }
+    }
+    close(s->fd); // under the lock: shutdown_shm_sessions() may be using it
+    pthread_cond_signal(&shm_done);
+    pthread_mutex_unlock(&shm_lock);
+
+    shm_ring_destroy(s->requests);
+    shm_ring_destroy(s->replies);
+    free(c->in.data);
+    free(c->out.data);
+    free(s);
     return NULL;
 }
 
-// Helper function to send a line over socket
-static int send_line(int fd, const char *s) {
-    size_t n = strlen(s);
-    return (int)write(fd, s, n) == (int)n;
+// Send the two ring memfds to a new shm: client (see rpc_protocol.hpp)
+static int send_ring_fds(int sock, const int fds[2]) {
+    char byte = 'R';
+    struct iovec iov = {&byte, 1};
+    union {
+        char buf[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } u;
+    memset(&u, 0, sizeof(u));
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof(u.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(2 * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, 2 * sizeof(int));
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+// Accept every pending shm: client: create its rings, hand them over, start its thread
+static void accept_shm_clients(Worker *w) {
+    unsigned spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? 4096 : 0; // spinning on one CPU only delays the client
+    while (1) {
+        int cfd = accept4(shm_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
+
+        ShmSession *s = (ShmSession*)calloc(1, sizeof(ShmSession));
+        int fds[2] = {-1, -1};
+        if (s == NULL ||
+            !shm_ring_create(s->requests, RPC_SHM_RING_BYTES, RPC_SHM_RING_BYTES / 16, spin, &fds[0]) ||
+            !shm_ring_create(s->replies, RPC_SHM_RING_BYTES, RPC_SHM_RING_BYTES / 16, spin, &fds[1]) ||
+            send_ring_fds(cfd, fds) < 0) {
+            perror("shm session");
+            if (s != NULL) {
+                shm_ring_destroy(s->requests);
+                shm_ring_destroy(s->replies);
+            }
+            free(s);
+            close(cfd);
+        } else {
+            s->fd = cfd;
+            s->requests.peer_fd = cfd;
+            s->replies.peer_fd = cfd;
+            s->conn.fd = -1; // replies go through the ring, never a socket
+            s->conn.w = &s->stats;
+            strcpy(s->conn.peer, "shared memory");
+
+            // Listed before the thread starts, which removes it again when it finishes
+            pthread_mutex_lock(&shm_lock);
+            s->next = shm_sessions;
+            shm_sessions = s;
+            pthread_t tid;
+            int rc = pthread_create(&tid, NULL, shm_session_main, s);
+            if (rc != 0) {
+                shm_sessions = s->next;
+                pthread_mutex_unlock(&shm_lock);
+                fprintf(stderr, "shm session: pthread_create: %s\n", strerror(rc));
+                shm_ring_destroy(s->requests);
+                shm_ring_destroy(s->replies);
+                free(s);
+                close(cfd);
+            } else {
+                pthread_mutex_unlock(&shm_lock);
+                pthread_detach(tid);
+                w->connections++;
+                printf("Client connected over shared memory\n");
+            }
+        }
+        for (int fd : fds) {
+            if (fd >= 0) close(fd); // the client has its own copies now
+        }
+    }
+}
+
+// Shutdown: hang up on every shm: client and wait for the session threads to finish
+static void shutdown_shm_sessions(void) {
+    pthread_mutex_lock(&shm_lock);
+    for (ShmSession *s = shm_sessions; s != NULL; s = s->next) {
+        shutdown(s->fd, SHUT_RDWR); // the thread notices within SHM_RING_PEER_CHECK_MS
+    }
+    while (shm_sessions != NULL) {
+        pthread_cond_wait(&shm_done, &shm_lock);
+    }
+    pthread_mutex_unlock(&shm_lock);
+}
+
+// Bind a Unix stream socket for -l unix:PATH or -l shm:NAME
+static int open_local_listener(const struct sockaddr_un *addr, socklen_t len) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (bind(fd, (const struct sockaddr*)addr, len) < 0 || listen(fd, SOMAXCONN) < 0) {
+        perror(addr->sun_path[0] ? addr->sun_path : "bind");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Answer every frame of one request datagram with one reply datagram, written to `reply`
+// (RPC_UDP_MAX_DATAGRAM bytes). Returns the reply length (0: nothing to send).
+static size_t handle_datagram(Worker *w, const char *req, size_t len, char *reply) {
+    size_t off = 0, out = 0;
+    RpcFrame f;
+    int n;
+    while (off < len && out + RPC_HEADER_SIZE + 8 <= RPC_UDP_MAX_DATAGRAM &&
+           (n = rpc_parse_frame(req + off, len - off, &f)) > 0) {
+        off += (size_t)n;
+        if (f.opcode == RPC_OP_QUIT) continue; // there is no connection to close
+        w->requests++;
+        long long result = 0;
+        uint16_t rc = execute_frame(&f, &result);
+        int64_t res = result;
+        out += rpc_encode_frame(reply + out, rc, f.req_id, &res, rc == RPC_OK ? 1 : 0);
+    }
+    return out; // a malformed or truncated frame ends the datagram
+}
+
+// Drain the worker's UDP socket: up to UDP_BATCH datagrams per recvmmsg(), all answered with
+// one sendmmsg()
+static void serve_udp(Worker *w) {
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    struct sockaddr_storage from[UDP_BATCH];
+    char *replies = w->udp_bufs + (size_t)UDP_BATCH * RPC_UDP_MAX_DATAGRAM;
+
+    for (int rounds = 0; rounds < 16; rounds++) { // then let the TCP clients have a turn
+        for (int i = 0; i < UDP_BATCH; i++) {
+            iov[i].iov_base = w->udp_bufs + (size_t)i * RPC_UDP_MAX_DATAGRAM;
+            iov[i].iov_len = RPC_UDP_MAX_DATAGRAM;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &from[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+        }
+        int n = recvmmsg(w->udp_fd, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("recvmmsg");
+            return;
+        }
+        w->recv_calls++;
+        w->datagrams += (unsigned long long)n;
+
+        // Each reply goes back to its datagram's sender; the mmsghdrs are reused for sending
+        int out = 0;
+        for (int i = 0; i < n; i++) {
+            if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) continue; // larger than any client sends
+            char *reply = replies + (size_t)out * RPC_UDP_MAX_DATAGRAM;
+            size_t len = handle_datagram(w, (const char*)iov[i].iov_base, msgs[i].msg_len, reply);
+            if (len == 0) continue;
+            iov[out].iov_base = reply;
+            iov[out].iov_len = len;
+            msgs[out].msg_hdr.msg_name = &from[i];
+            msgs[out].msg_hdr.msg_namelen = msgs[i].msg_hdr.msg_namelen;
+            msgs[out].msg_hdr.msg_iov = &iov[out];
+            msgs[out].msg_hdr.msg_iovlen = 1;
+            out++;
+        }
+        // A reply that does not fit in the socket buffer is dropped, like any lost datagram:
+        // the client sends the request again
+        for (int sent = 0; sent < out; ) {
+            int k = sendmmsg(w->udp_fd, msgs + sent, (unsigned)(out - sent), MSG_DONTWAIT);
+            if (k <= 0) break;
+            sent += k;
+        }
+        if (n < UDP_BATCH) return; // drained
+    }
+}
+
+// One UDP socket per worker, all bound to the same port with SO_REUSEPORT: the kernel spreads
+// clients across workers just like TCP connections
+static int open_udp_socket(int port) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind(udp)");
+        close(fd);
+        return -1;
+    }
+    return fd;
 }
 
-int main(void) {
+// Create a listening socket on PORT. SO_REUSEPORT lets every worker bind its own socket to
+// the same port; the kernel then hashes incoming connections across them.
+static int open_listener(void) {
     // Create socket
-    int sfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sfd < 0) { 
-        perror("socket"); 
-        return 1; 
+    int sfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sfd < 0) {
+        perror("socket");
+        return -1;
     }
-    
-    // Set socket option to reuse address
+
+    // Set socket options to reuse address and share the port between workers
     int opt = 1;
     setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    
+    if (setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt(SO_REUSEPORT)");
+        close(sfd);
+        return -1;
+    }
+
     // Configure server address
     struct sockaddr_in addr = {0};
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY; // listen on all interfaces
     addr.sin_port = htons(PORT); // convert port to network byte order
-    
+
     // Bind socket to address
-    if (bind(sfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) { 
-        perror("bind"); 
-        return 1; 
-    }
-    
-    // Start listening for connections
-    if (listen(sfd, 1) < 0) { 
-        perror("listen"); 
-        return 1; 
-    }
-    
-    printf("RPC server listening on port %d\n", PORT);
-    
-    // Accept client connection
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    int cfd = accept(sfd, (struct sockaddr*)&client_addr, &client_len);
-    if (cfd < 0) {
-        perror("accept");
-        return 1;
+    if (bind(sfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(sfd);
+        return -1;
     }
-    
-    printf("Client connected from %s\n", inet_ntoa(client_addr.sin_addr));
-    
-    // Main RPC processing loop
-    char buffer[BUFSZ];
-    while (1) {
-        // Read request from client
-        ssize_t n = read(cfd, buffer, BUFSZ - 1);
-        if (n <= 0) break; // client disconnected or error
-        
-        buffer[n] = '\0'; // null-terminate
-        
-        // Parse request: format is "PROC_NAME arg1 arg2"
-        char proc_name[64];
-        long long a, b;
-        
-        if (sscanf(buffer, "%63s %lld %lld", proc_name, &a, &b) != 3) {
-            send_line(cfd, "ERR invalid_format\n");
-            continue;
+
+    // Start listening for connections (SOMAXCONN: bursts of connects must not be refused)
+    if (listen(sfd, SOMAXCONN) < 0) {
+        perror("listen");
+        close(sfd);
+        return -1;
+    }
+    return sfd;
+}
+
+// Set up the worker's epoll instance: its listener plus the shared shutdown eventfd
+static int init_worker(Worker *w) {
+    w->sfd = open_listener();
+    if (w->sfd < 0) return -1;
+
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (w->epfd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+
+    // The listening socket stays level-triggered so a failed accept (e.g. EMFILE) is retried
+    struct epoll_event lev;
+    lev.events = EPOLLIN;
+    lev.data.ptr = NULL; // NULL marks the listener; clients carry their Conn*
+    struct epoll_event sev;
+    sev.events = EPOLLIN; // level-triggered, so every worker sees the same wake-up
+    sev.data.ptr = &stop_marker;
+    if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->sfd, &lev) < 0 ||
+        epoll_ctl(w->epfd, EPOLL_CTL_ADD, stop_fd, &sev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+
+    // Shared local listeners: every worker waits on them, but only one is woken per connection
+    struct epoll_event xev;
+    xev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    xev.data.ptr = &unix_marker;
+    if (unix_fd >= 0 && epoll_ctl(w->epfd, EPOLL_CTL_ADD, unix_fd, &xev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+    xev.data.ptr = &shm_marker;
+    if (shm_fd >= 0 && epoll_ctl(w->epfd, EPOLL_CTL_ADD, shm_fd, &xev) < 0) {
+        perror("epoll_ctl");
+        return -1;
+    }
+
+    w->udp_fd = -1;
+    if (udp_port >= 0) {
+        w->udp_fd = open_udp_socket(udp_port);
+        w->udp_bufs = (char*)malloc(2 * (size_t)UDP_BATCH * RPC_UDP_MAX_DATAGRAM);
+        struct epoll_event uev;
+        uev.events = EPOLLIN; // level-triggered: serve_udp() may stop before the socket is empty
+        uev.data.ptr = &udp_marker;
+        if (w->udp_fd < 0 || w->udp_bufs == NULL || epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->udp_fd, &uev) < 0) {
+            perror("udp");
+            return -1;
         }
-        
-        // Find the requested procedure
-        Proc *p = find_proc(proc_name);
-        if (p == NULL) {
-            send_line(cfd, "ERR unknown_procedure\n");
-            continue;
+    }
+    return 0;
+}
+
+// Event loop: one thread serves every connection that landed on this worker's listener
+static void* worker_main(void *arg) {
+    Worker *w = (Worker*)arg;
+
+    if (w->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            fprintf(stderr, "worker %d: cannot pin to CPU %d: %s\n", w->id, w->cpu, strerror(rc));
         }
-        
-        // Check arity (number of arguments)
-        if (p->arity != 2) {
-            send_line(cfd, "ERR wrong_arity\n");
-            continue;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (1) {
+        int n = epoll_wait(w->epfd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
         }
-        
-        // Execute the procedure
-        long long out = 0;
-        int rc = p->fn(a, b, &out);
-        
-        if (rc == 0) {
-            // Success - send result
-            char line[64];
-            snprintf(line, sizeof(line), "OK %lld\n", out);
-            send_line(cfd, line);
-        } else if (p == find_proc("div")) {
-            // Special error handling for division by zero
-            send_line(cfd, "ERR divide_by_zero\n");
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == &stop_marker) {
+                return NULL; // shutdown requested
+            }
+            if (events[i].data.ptr == NULL) {
+                accept_clients(w, w->sfd);
+                continue;
+            }
+            if (events[i].data.ptr == &unix_marker) {
+                accept_clients(w, unix_fd);
+                continue;
+            }
+            if (events[i].data.ptr == &shm_marker) {
+                accept_shm_clients(w);
+                continue;
+            }
+            if (events[i].data.ptr == &udp_marker) {
+                serve_udp(w);
+                continue;
+            }
+
+            Conn *c = (Conn*)events[i].data.ptr;
+            uint32_t ev = events[i].events;
+            int dead = (ev & EPOLLERR) != 0;
+
+            if (!dead && (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                dead = handle_readable(c, (ev & (EPOLLRDHUP | EPOLLHUP)) != 0) < 0;
+            }
+            // Flush on EPOLLOUT and after reading: replies generated above go out right away
+            if (!dead) {
+                size_t before = c->out.len - c->out.off;
+                dead = flush_output(c) < 0;
+                // Output drained below the high-water mark: resume input we stopped reading
+                if (!dead && before > OUT_HIGH_WATER && c->out.len - c->out.off <= OUT_HIGH_WATER) {
+                    dead = handle_readable(c, 1) < 0 || flush_output(c) < 0;
+                }
+            }
+            if (dead || (c->closing && c->out.off == c->out.len)) {
+                close_conn(c);
+            }
+        }
+    }
+    return NULL;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+    // -w N: run N pinned event loops (0 = one per online CPU). Default is a single loop.
+    // -l unix:PATH / -l shm:NAME / -l udp[:PORT]: also listen on these transports (TCP is
+    // always on).
+    int nworkers = 1;
+    int pin = 0;
+    int ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *shm_name = NULL;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+            nworkers = atoi(argv[++i]);
+            if (nworkers == 0) nworkers = ncpu;
+            pin = 1;
+        } else if (i + 1 < argc && strcmp(argv[i], "-l") == 0 && strncmp(argv[i + 1], "unix:", 5) == 0) {
+            unix_path = argv[++i] + 5;
+        } else if (i + 1 < argc && strcmp(argv[i], "-l") == 0 && strncmp(argv[i + 1], "shm:", 4) == 0) {
+            shm_name = argv[++i] + 4;
+        } else if (i + 1 < argc && strcmp(argv[i], "-l") == 0 && strncmp(argv[i + 1], "udp", 3) == 0) {
+            const char *p = argv[++i] + 3;
+            udp_port = *p == ':' ? atoi(p + 1) : *p == '\0' ? PORT : -1;
+            usage = udp_port <= 0 || udp_port > 65535;
         } else {
-            // General execution error
-            send_line(cfd, "ERR exec_failed\n");
+            usage = true;
+        }
+    }
+    if (usage) {
+        fprintf(stderr, "Usage: %s [-w N_workers] [-l unix:PATH] [-l shm:NAME] [-l udp[:PORT]]  (N = 0 means one per CPU)\n",
+                argv[0]);
+        return 1;
+    }
+    if (nworkers < 1 || nworkers > MAX_WORKERS) {
+        fprintf(stderr, "Invalid args: 0 < N <= %d\n", MAX_WORKERS);
+        return 1;
+    }
+
+    // Block SIGINT/SIGTERM in every thread; main collects them with sigwait() and then wakes
+    // the workers through stop_fd. A client vanishing mid-write must not kill the server.
+    sigset_t stop_sigs;
+    sigemptyset(&stop_sigs);
+    sigaddset(&stop_sigs, SIGINT);
+    sigaddset(&stop_sigs, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_sigs, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        perror("eventfd");
+        return 1;
+    }
+
+    if (unix_path != NULL) {
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (strlen(unix_path) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "unix socket path too long\n");
+            return 1;
+        }
+        strcpy(addr.sun_path, unix_path);
+        unlink(unix_path); // left behind by a previous run
+        unix_fd = open_local_listener(&addr, sizeof(addr));
+        if (unix_fd < 0) return 1;
+    }
+    if (shm_name != NULL) {
+        struct sockaddr_un addr;
+        socklen_t len = rpc_shm_address(shm_name, &addr);
+        if (len == 0) {
+            fprintf(stderr, "shm name too long\n");
+            return 1;
+        }
+        shm_fd = open_local_listener(&addr, len);
+        if (shm_fd < 0) return 1;
+    }
+
+    static Worker workers[MAX_WORKERS];
+    for (int i = 0; i < nworkers; i++) {
+        workers[i].id = i;
+        workers[i].cpu = pin ? i % ncpu : -1;
+        if (init_worker(&workers[i]) < 0) return 1;
+    }
+
+    if (nworkers == 1) {
+        printf("RPC server listening on port %d\n", PORT);
+    } else {
+        printf("RPC server listening on port %d (%d workers, SO_REUSEPORT)\n", PORT, nworkers);
+    }
+    if (unix_fd >= 0) printf("RPC server listening on unix:%s\n", unix_path);
+    if (shm_fd >= 0) printf("RPC server listening on shm:%s\n", shm_name);
+    if (udp_port >= 0) printf("RPC server listening on udp port %d\n", udp_port);
+    fflush(stdout);
+
+    double start = now_sec();
+    for (int i = 0; i < nworkers; i++) {
+        pthread_create(&workers[i].tid, NULL, worker_main, &workers[i]);
+    }
+
+    // Wait for Ctrl+C, then wake every worker
+    int sig;
+    sigwait(&stop_sigs, &sig);
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) != sizeof(one)) perror("write(stop_fd)");
+
+    unsigned long long total = 0;
+    for (int i = 0; i < nworkers; i++) {
+        pthread_join(workers[i].tid, NULL);
+        total += workers[i].requests;
+    }
+    shutdown_shm_sessions();
+    total += shm_requests;
+    double elapsed = now_sec() - start;
+
+    // Per-worker report: an even split means the kernel balanced connections across listeners
+    if (nworkers > 1) {
+        for (int i = 0; i < nworkers; i++) {
+            printf("worker %d (cpu %d): %llu connections, %llu requests\n",
+                   i, workers[i].cpu, workers[i].connections, workers[i].requests);
+        }
+    }
+    printf("%llu requests in %.2f s (%.0f requests/sec)\n", total, elapsed, elapsed > 0 ? total / elapsed : 0.0);
+    if (udp_port >= 0) {
+        unsigned long long datagrams = 0, calls = 0;
+        for (int i = 0; i < nworkers; i++) {
+            datagrams += workers[i].datagrams;
+            calls += workers[i].recv_calls;
         }
+        printf("udp: %llu datagrams in %llu recvmmsg calls (%.1f per call)\n", datagrams, calls,
+               calls ? (double)datagrams / (double)calls : 0.0);
     }
-    
+
     // Cleanup
-    close(cfd);
-    close(sfd);
+    for (int i = 0; i < nworkers; i++) {
+        close(workers[i].epfd);
+        close(workers[i].sfd);
+        if (workers[i].udp_fd >= 0) close(workers[i].udp_fd);
+        free(workers[i].udp_bufs);
+    }
+    close(stop_fd);
+    if (unix_fd >= 0) {
+        close(unix_fd);
+        unlink(unix_path);
+    }
+    if (shm_fd >= 0) close(shm_fd);
     printf("RPC server shutting down\n");
     return 0;
 }
@@ -0,0 +1,60 @@
+// Round-trip latency of one synchronous call (rpc_add) over each transport.
+//
+//   ./transport_bench [calls] [address ...]
+//
+// Defaults: 100000 calls to each of tcp:127.0.0.1:8080, unix:/tmp/rpc.sock and shm:rpc, which
+// is what `./rpc_server -l unix:/tmp/rpc.sock -l shm:rpc` listens on.
+#include "rpc_client.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char** argv) {
+    int calls = (argc > 1) ? atoi(argv[1]) : 100000;
+    std::vector<const char*> addresses(argv + (argc > 1 ? 2 : 1), argv + argc);
+    if (addresses.empty()) addresses = {"tcp:127.0.0.1:8080", "unix:/tmp/rpc.sock", "shm:rpc"};
+    if (calls < 1) {
+        fprintf(stderr, "Usage: %s [calls] [address ...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d synchronous calls per transport, round trip in microseconds\n", calls);
+    printf("%-24s %8s %8s %8s %8s %12s\n", "transport", "mean", "p50", "p99", "max", "calls/sec");
+    std::vector<long long> rtt((size_t)calls);
+    for (const char* address : addresses) {
+        RpcClient c;
+        if (!rpc_connect(c, address)) {
+            printf("%-24s cannot connect\n", address);
+            continue;
+        }
+        long long result;
+        for (int i = 0; i < 1000; i++) rpc_add(c, i, 1, result); // warm up
+
+        bool ok = true;
+        long long start = now_ns();
+        for (int i = 0; i < calls && ok; i++) {
+            long long t0 = now_ns();
+            ok = rpc_add(c, i, 1, result) && result == i + 1;
+            rtt[(size_t)i] = now_ns() - t0;
+        }
+        long long elapsed = now_ns() - start;
+        rpc_close(c);
+        if (!ok) {
+            printf("%-24s call failed\n", address);
+            continue;
+        }
+
+        std::sort(rtt.begin(), rtt.end());
+        printf("%-24s %8.2f %8.2f %8.2f %8.1f %12.0f\n", address, elapsed / 1e3 / calls, rtt[(size_t)calls / 2] / 1e3,
+               rtt[(size_t)calls * 99 / 100] / 1e3, rtt.back() / 1e3, calls / (elapsed / 1e9));
+    }
+    return 0;
+}
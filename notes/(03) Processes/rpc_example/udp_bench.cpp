@@ -0,0 +1,85 @@
+// Request packets per second over UDP versus TCP. Every thread has a connection of its own and
+// makes calls in batches of [batch] (1: one synchronous call at a time), for [seconds].
+//
+//   ./udp_bench [threads] [seconds] [batch] [address ...]
+//
+// Defaults: 8 threads, 3 seconds, batch 1, against tcp:127.0.0.1:8080 and udp:127.0.0.1:8080,
+// which is what `./rpc_server -l udp` listens on. With batch 1 every call is a datagram of its
+// own; larger batches pack up to RPC_UDP_MAX_DATAGRAM bytes of frames into each datagram.
+#include "rpc_client.hpp"
+#include "rpc_protocol.hpp"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+static int seconds;
+static int batch;
+static const char* address;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Returns the number of calls completed, or -1 if the connection failed
+static void* bench_worker(void*) {
+    RpcClient c;
+    if (!rpc_connect(c, address)) return (void*)-1L;
+
+    std::vector<RpcCall> calls((size_t)batch);
+    long done = 0;
+    double end = now_sec() + seconds;
+    while (now_sec() < end) {
+        for (int i = 0; i < batch; i++) calls[(size_t)i] = {RPC_OP_ADD, done + i, 1, false, 0};
+        if (!rpc_batch(c, calls.data(), calls.size())) {
+            done = -1;
+            break;
+        }
+        for (int i = 0; i < batch; i++) {
+            if (!calls[(size_t)i].ok || calls[(size_t)i].result != done + i + 1) {
+                fprintf(stderr, "%s: wrong result\n", address);
+            }
+        }
+        done += batch;
+    }
+    rpc_close(c);
+    return (void*)done;
+}
+
+int main(int argc, char** argv) {
+    int threads = (argc > 1) ? atoi(argv[1]) : 8;
+    seconds = (argc > 2) ? atoi(argv[2]) : 3;
+    batch = (argc > 3) ? atoi(argv[3]) : 1;
+    std::vector<const char*> addresses(argv + (argc > 3 ? 4 : argc), argv + argc);
+    if (addresses.empty()) addresses = {"tcp:127.0.0.1:8080", "udp:127.0.0.1:8080"};
+    if (threads < 1 || seconds < 1 || batch < 1 || batch > RPC_MAX_INFLIGHT) {
+        fprintf(stderr, "Usage: %s [threads] [seconds] [batch] [address ...]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%d threads, %d s, %d call(s) per batch\n", threads, seconds, batch);
+    printf("%-24s %12s %12s\n", "transport", "calls/sec", "per thread");
+    for (const char* a : addresses) {
+        address = a;
+        std::vector<pthread_t> tids((size_t)threads);
+        for (pthread_t& t : tids) pthread_create(&t, NULL, bench_worker, NULL);
+
+        long total = 0;
+        bool failed = false;
+        for (pthread_t& t : tids) {
+            void* ret;
+            pthread_join(t, &ret);
+            if ((long)ret < 0) failed = true;
+            else total += (long)ret;
+        }
+        if (failed) {
+            printf("%-24s connection failed\n", a);
+            continue;
+        }
+        printf("%-24s %12.0f %12.0f\n", a, (double)total / seconds, (double)total / seconds / threads);
+    }
+    return 0;
+}
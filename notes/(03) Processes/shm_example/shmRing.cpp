@@ -0,0 +1,230 @@
+// Parent/child IPC through the shared-memory ring in shm_ring.hpp, measured against an ordinary
+// pipe (the write()/read() path of pipe_example/ordinaryPipe.cpp).
+//
+//   ./shmRing [MB]    MB = bytes streamed per throughput run (default 1024)
+#include "shm_ring.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define PING_ROUNDS 100000
+#define RING_BYTES (4 << 20)
+
+static unsigned spin_polls; // 0 on a single CPU
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static bool write_full(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Read exactly len bytes; false on EOF or error
+static bool read_full(int fd, char *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static bool reap(pid_t pid) {
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// ---------------------------------------------------------------------------------------
+// Latency: the parent sends 8 bytes, the child sends them back, PING_ROUNDS times
+// ---------------------------------------------------------------------------------------
+
+static double ping_shm(void) {
+    ShmRing to_child, to_parent;
+    if (!shm_ring_create(to_child, 4096, 8, spin_polls) || !shm_ring_create(to_parent, 4096, 8, spin_polls)) {
+        perror("shm_ring_create");
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        uint64_t v;
+        while (shm_ring_read(to_child, &v, sizeof(v)) >= 0) {
+            shm_ring_write(to_parent, &v, sizeof(v));
+            shm_ring_flush(to_parent);
+        }
+        exit(0);
+    }
+    double start = now_sec();
+    for (uint64_t i = 0; i < PING_ROUNDS; i++) {
+        uint64_t v = i;
+        shm_ring_write(to_child, &v, sizeof(v));
+        shm_ring_flush(to_child); // latency test: publish every message immediately
+        if (shm_ring_read(to_parent, &v, sizeof(v)) != sizeof(v) || v != i) {
+            fprintf(stderr, "shm ping-pong: bad reply\n");
+            return -1;
+        }
+    }
+    double elapsed = now_sec() - start;
+    shm_ring_close(to_child);
+    bool ok = reap(pid);
+    shm_ring_destroy(to_child);
+    shm_ring_destroy(to_parent);
+    return ok ? elapsed / PING_ROUNDS / 2 * 1e6 : -1;
+}
+
+static double ping_pipe(void) {
+    int down[2], up[2];
+    if (pipe(down) == -1 || pipe(up) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(down[1]);
+        close(up[0]);
+        uint64_t v;
+        while (read_full(down[0], (char *)&v, sizeof(v))) write_full(up[1], (char *)&v, sizeof(v));
+        exit(0);
+    }
+    close(down[0]);
+    close(up[1]);
+    double start = now_sec();
+    for (uint64_t i = 0; i < PING_ROUNDS; i++) {
+        uint64_t v = i;
+        write_full(down[1], (char *)&v, sizeof(v));
+        if (!read_full(up[0], (char *)&v, sizeof(v)) || v != i) {
+            fprintf(stderr, "pipe ping-pong: bad reply\n");
+            return -1;
+        }
+    }
+    double elapsed = now_sec() - start;
+    close(down[1]);
+    close(up[0]);
+    return reap(pid) ? elapsed / PING_ROUNDS / 2 * 1e6 : -1;
+}
+
+// ---------------------------------------------------------------------------------------
+// Throughput: stream total bytes as messages of msg_size bytes
+// ---------------------------------------------------------------------------------------
+
+// The child checks message contents (byte i of message k is (k + i) & 0xFF) for the first
+// messages and the total byte count for all of them
+static bool check_message(const char *buf, size_t len, uint64_t k) {
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] != (char)((k + i) & 0xFF)) return false;
+    }
+    return true;
+}
+
+static double stream_shm(size_t msg_size, uint64_t count, const char *src) {
+    ShmRing ring;
+    if (!shm_ring_create(ring, RING_BYTES, RING_BYTES / 16, spin_polls)) {
+        perror("shm_ring_create");
+        return -1;
+    }
+    fflush(stdout);
+    double start = now_sec();
+    pid_t pid = fork();
+    if (pid == 0) {
+        char *buf = (char *)malloc(msg_size);
+        uint64_t k = 0, bytes = 0;
+        long n;
+        while ((n = shm_ring_read(ring, buf, msg_size)) >= 0) {
+            if (k < 256 && !check_message(buf, (size_t)n, k)) exit(3);
+            bytes += (uint64_t)n;
+            k++;
+        }
+        exit(k == count && bytes == count * msg_size ? 0 : 2);
+    }
+    for (uint64_t k = 0; k < count; k++) {
+        shm_ring_write(ring, src + (k & 0xFF), (uint32_t)msg_size);
+    }
+    shm_ring_close(ring);
+    bool ok = reap(pid);
+    double elapsed = now_sec() - start;
+    shm_ring_destroy(ring);
+    return ok ? (double)(msg_size * count) / elapsed / 1e9 : -1;
+}
+
+static double stream_pipe(size_t msg_size, uint64_t count, const char *src) {
+    int fd[2];
+    if (pipe(fd) == -1) {
+        perror("pipe");
+        return -1;
+    }
+    fflush(stdout);
+    double start = now_sec();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fd[1]);
+        char *buf = (char *)malloc(msg_size);
+        uint64_t k = 0;
+        while (read_full(fd[0], buf, msg_size)) {
+            if (k < 256 && !check_message(buf, msg_size, k)) exit(3);
+            k++;
+        }
+        exit(k == count ? 0 : 2);
+    }
+    close(fd[0]);
+    for (uint64_t k = 0; k < count; k++) {
+        if (!write_full(fd[1], src + (k & 0xFF), msg_size)) break;
+    }
+    close(fd[1]);
+    bool ok = reap(pid);
+    double elapsed = now_sec() - start;
+    return ok ? (double)(msg_size * count) / elapsed / 1e9 : -1;
+}
+
+int main(int argc, char **argv) {
+    size_t total_mb = (argc > 1) ? (size_t)atol(argv[1]) : 1024;
+    if (total_mb < 1) {
+        fprintf(stderr, "Usage: %s [MB per throughput run]\n", argv[0]);
+        return 1;
+    }
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    spin_polls = ncpu > 1 ? 4096 : 0; // spinning on one CPU only delays the other process
+
+    printf("%ld CPUs, %s\n", ncpu, spin_polls ? "spin then futex wait" : "futex wait without spinning");
+
+    double shm_lat = ping_shm();
+    double pipe_lat = ping_pipe();
+    if (shm_lat < 0 || pipe_lat < 0) return 1;
+    printf("\nOne-way latency (8-byte ping-pong, %d rounds)\n", PING_ROUNDS);
+    printf("  shm ring: %8.2f us\n", shm_lat);
+    printf("  pipe:     %8.2f us\n", pipe_lat);
+
+    // Message k starts at src + (k & 0xFF), so every message carries a different pattern
+    static const size_t msg_sizes[] = {64, 1024, 16384, 65536};
+    char *src = (char *)malloc(65536 + 256);
+    for (size_t i = 0; i < 65536 + 256; i++) src[i] = (char)(i & 0xFF);
+
+    printf("\nThroughput (%zu MB per run, %d KB ring)\n", total_mb, RING_BYTES >> 10);
+    printf("%10s %14s %14s %10s\n", "msg size", "shm ring", "pipe", "speedup");
+    for (size_t msg_size : msg_sizes) {
+        uint64_t count = (uint64_t)(total_mb << 20) / msg_size;
+        double shm = stream_shm(msg_size, count, src);
+        double pip = stream_pipe(msg_size, count, src);
+        if (shm < 0 || pip < 0) {
+            fprintf(stderr, "%zu-byte run failed\n", msg_size);
+            return 1;
+        }
+        printf("%8zu B %9.2f GB/s %9.2f GB/s %9.1fx\n", msg_size, shm, pip, shm / pip);
+    }
+    free(src);
+    return 0;
+}
@@ -0,0 +1,355 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <atomic>
+#include <new>
+
+// Single-producer/single-consumer message ring in shared memory.
+//
+// shm_ring_create() maps a memfd (or an unlinked shm_open() object on kernels without memfd),
+// so the ring is shared with any child forked afterwards. The mapping holds a header followed
+// by `capacity` data bytes. Messages are stored back to back as [u32 length][payload], each
+// record aligned to 8 bytes; a record that would run past the end is preceded by a wrap marker
+// and starts again at offset 0.
+//
+//   head  bytes consumed so far (written only by the consumer)
+//   tail  bytes published so far (written only by the producer)
+//
+// Both counters grow forever and are masked with capacity - 1, so head == tail means empty and
+// tail - head == capacity means full. Each one sits on its own cache line, and each side keeps
+// a private copy of the other's counter, so a steady stream touches the shared line of the
+// other side only when its copy says it has to.
+//
+// Publication is batched: shm_ring_write() only makes records visible once `batch` bytes have
+// accumulated (or on shm_ring_flush()), and the consumer hands space back in the same steps.
+// A side that finds nothing to do spins briefly and then sleeps on a futex, so an idle
+// consumer costs no CPU.
+//
+// Processes that are not related by fork() can share a ring too: shm_ring_create() can return
+// the memfd, which is passed over a Unix socket (SCM_RIGHTS) and mapped with shm_ring_attach().
+// Such a peer can die without closing the ring, so set peer_fd to a socket connected to it:
+// a waiting consumer (or a producer waiting for space) then checks every
+// SHM_RING_PEER_CHECK_MS whether it has hung up.
+//
+// Such a peer can also write anything into the shared memory. Each side therefore keeps its
+// own copy of the ring's geometry (capacity, batch, spin), and the consumer checks every record
+// length against the ring before it copies anything.
+
+#define SHM_RING_WRAP 0xFFFFFFFFu // length value that means "continue at offset 0"
+#define SHM_RING_CACHELINE 64
+#define SHM_RING_PEER_CHECK_MS 100
+
+struct ShmRingShared {
+    alignas(SHM_RING_CACHELINE) std::atomic<uint64_t> head; // consumer position
+    std::atomic<uint32_t> space_seq; // bumped when the consumer frees space for a waiting producer
+    std::atomic<uint32_t> producer_waiting;
+
+    alignas(SHM_RING_CACHELINE) std::atomic<uint64_t> tail; // producer position
+    std::atomic<uint32_t> data_seq; // bumped when the producer publishes to a waiting consumer
+    std::atomic<uint32_t> consumer_waiting;
+    std::atomic<uint32_t> closed; // producer is done: the consumer sees EOF once it drains
+
+    alignas(SHM_RING_CACHELINE) uint64_t capacity; // data bytes, power of two
+    uint64_t batch; // publish after this many bytes
+    uint32_t spin; // polls before sleeping on the futex
+};
+
+// Per-process view of the ring. The producer uses the tail fields, the consumer the head fields.
+struct ShmRing {
+    ShmRingShared *shared = NULL;
+    char *data = NULL;
+    size_t map_size = 0;
+    uint64_t capacity = 0; // private copies of the shared settings, which the peer could change
+    uint64_t batch = 0;
+    unsigned spin = 0;
+    uint64_t mask = 0;
+
+    uint64_t tail = 0; // producer: end of the last record written (published or not)
+    uint64_t tail_published = 0;
+    uint64_t head_cache = 0; // producer: last head it saw
+
+    uint64_t head = 0; // consumer: next record to read
+    uint64_t head_published = 0;
+    uint64_t tail_cache = 0; // consumer: last tail it saw
+    int peer_fd = -1; // socket to the other side's process, or -1 (see above)
+};
+
+static inline void shm_ring_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Process-shared futex: the word lives in a MAP_SHARED mapping, so no FUTEX_PRIVATE_FLAG
+static inline void shm_futex_wait(std::atomic<uint32_t> *word, uint32_t expected,
+                                  const struct timespec *timeout = NULL) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+static inline void shm_futex_wake(std::atomic<uint32_t> *word) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+// Create a ring with capacity data bytes (rounded up to a power of two). Call before fork(),
+// or pass fd_out to get the memfd for shm_ring_attach() in another process (the caller closes
+// it). spin = polls before sleeping; pass 0 on a single CPU, where the other side cannot make
+// progress while we spin.
+static inline bool shm_ring_create(ShmRing &r, size_t capacity, size_t batch, unsigned spin, int *fd_out = NULL) {
+    uint64_t cap = 4096;
+    while (cap < capacity) cap <<= 1;
+    size_t map_size = sizeof(ShmRingShared) + cap;
+
+    int fd = (int)syscall(SYS_memfd_create, "shm_ring", MFD_CLOEXEC);
+    if (fd < 0) {
+        // No memfd: use a POSIX shared memory object and unlink it right away, so that like the
+        // memfd it disappears with the last mapping
+        char name[64];
+        snprintf(name, sizeof(name), "/shm_ring.%d", getpid());
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (fd < 0) return false;
+        shm_unlink(name);
+    }
+    if (ftruncate(fd, (off_t)map_size) < 0) {
+        close(fd);
+        return false;
+    }
+    void *mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED || !fd_out) close(fd); // the mapping keeps the memory alive
+    if (mem == MAP_FAILED) return false;
+    if (fd_out) *fd_out = fd;
+
+    r = ShmRing();
+    r.shared = new (mem) ShmRingShared();
+    r.shared->capacity = cap;
+    r.shared->batch = batch < 8 ? 8 : (batch > cap / 2 ? cap / 2 : batch);
+    r.shared->spin = spin;
+    r.data = (char *)mem + sizeof(ShmRingShared);
+    r.map_size = map_size;
+    r.capacity = cap;
+    r.batch = r.shared->batch;
+    r.spin = spin;
+    r.mask = cap - 1;
+    return true;
+}
+
+// Map a ring that another process created, from the fd it got from shm_ring_create()
+static inline bool shm_ring_attach(ShmRing &r, int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size <= sizeof(ShmRingShared)) return false;
+    size_t map_size = (size_t)st.st_size;
+    void *mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) return false;
+
+    ShmRingShared *s = (ShmRingShared *)mem;
+    uint64_t cap = s->capacity, batch = s->batch;
+    if (cap != map_size - sizeof(ShmRingShared) || cap < 4096 || (cap & (cap - 1)) != 0 || batch < 8 ||
+        batch > cap / 2) {
+        munmap(mem, map_size);
+        return false;
+    }
+    r = ShmRing();
+    r.shared = s;
+    r.data = (char *)mem + sizeof(ShmRingShared);
+    r.map_size = map_size;
+    r.capacity = cap;
+    r.batch = batch;
+    r.spin = s->spin;
+    r.mask = cap - 1;
+    r.tail = r.tail_published = r.head_cache = s->tail.load(std::memory_order_acquire);
+    r.head = r.head_published = r.tail_cache = s->head.load(std::memory_order_acquire);
+    return true;
+}
+
+// True once the process at the other end of peer_fd has closed it (or exited)
+static inline bool shm_peer_gone(int peer_fd) {
+    struct pollfd p = {peer_fd, POLLRDHUP, 0};
+    return poll(&p, 1, 0) == 1 && (p.revents & (POLLRDHUP | POLLHUP | POLLERR));
+}
+
+static inline void shm_ring_destroy(ShmRing &r) {
+    if (r.shared) munmap(r.shared, r.map_size);
+    r = ShmRing();
+}
+
+// Largest message shm_ring_write() accepts: a record plus a wrap marker must fit at once
+static inline size_t shm_ring_max_message(const ShmRing &r) {
+    return r.capacity / 2 - 8;
+}
+
+// ---------------------------------------------------------------------------------------
+// Producer side
+// ---------------------------------------------------------------------------------------
+
+// Make everything written so far visible and wake the consumer if it is asleep
+static inline void shm_ring_flush(ShmRing &r) {
+    if (r.tail == r.tail_published) return;
+    ShmRingShared *s = r.shared;
+    s->tail.store(r.tail, std::memory_order_release);
+    r.tail_published = r.tail;
+    // Pairs with the consumer's fence between consumer_waiting = 1 and re-reading tail:
+    // either it sees the new tail, or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (s->consumer_waiting.load(std::memory_order_relaxed)) {
+        s->consumer_waiting.store(0, std::memory_order_relaxed);
+        s->data_seq.fetch_add(1, std::memory_order_release);
+        shm_futex_wake(&s->data_seq);
+    }
+}
+
+// Block until `need` bytes are free. Returns false if peer_fd is set and the consumer has gone away.
+static inline bool shm_ring_wait_space(ShmRing &r, uint64_t need) {
+    ShmRingShared *s = r.shared;
+    uint64_t cap = r.capacity;
+    for (unsigned i = 0;; i++) {
+        r.head_cache = s->head.load(std::memory_order_acquire);
+        if (r.tail + need - r.head_cache <= cap) return true;
+        if (i == 0) shm_ring_flush(r); // the consumer may be waiting for what we hold back
+        if (i < r.spin) {
+            shm_ring_pause();
+            continue;
+        }
+        uint32_t seq = s->space_seq.load(std::memory_order_acquire);
+        s->producer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        r.head_cache = s->head.load(std::memory_order_acquire);
+        if (r.tail + need - r.head_cache <= cap) {
+            s->producer_waiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        if (r.peer_fd < 0) {
+            shm_futex_wait(&s->space_seq, seq);
+            continue;
+        }
+        struct timespec check = {0, SHM_RING_PEER_CHECK_MS * 1000000L};
+        shm_futex_wait(&s->space_seq, seq, &check);
+        if (shm_peer_gone(r.peer_fd)) return false;
+    }
+}
+
+// Copy one message into the ring, blocking while it is full. Returns false if len is larger
+// than shm_ring_max_message(), or peer_fd is set and the consumer went away while the ring was
+// full. The message becomes visible at the next batch boundary.
+static inline bool shm_ring_write(ShmRing &r, const void *msg, uint32_t len) {
+    if (len > shm_ring_max_message(r)) return false;
+    uint64_t cap = r.capacity;
+    uint64_t rec = (4 + (uint64_t)len + 7) & ~7ull;
+    uint64_t to_end = cap - (r.tail & r.mask);
+    uint64_t need = rec + (to_end < rec ? to_end : 0);
+    if (r.tail + need - r.head_cache > cap && !shm_ring_wait_space(r, need)) return false;
+
+    if (to_end < rec) {
+        uint32_t wrap = SHM_RING_WRAP;
+        memcpy(r.data + (r.tail & r.mask), &wrap, 4);
+        r.tail += to_end;
+    }
+    char *p = r.data + (r.tail & r.mask);
+    memcpy(p, &len, 4);
+    memcpy(p + 4, msg, len);
+    r.tail += rec;
+    if (r.tail - r.tail_published >= r.batch) shm_ring_flush(r);
+    return true;
+}
+
+// Flush and tell the consumer no more messages will come
+static inline void shm_ring_close(ShmRing &r) {
+    shm_ring_flush(r);
+    ShmRingShared *s = r.shared;
+    s->closed.store(1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    s->consumer_waiting.store(0, std::memory_order_relaxed);
+    s->data_seq.fetch_add(1, std::memory_order_release);
+    shm_futex_wake(&s->data_seq);
+}
+
+// ---------------------------------------------------------------------------------------
+// Consumer side
+// ---------------------------------------------------------------------------------------
+
+// Hand consumed space back to the producer and wake it if it is waiting for room
+static inline void shm_ring_release(ShmRing &r) {
+    if (r.head == r.head_published) return;
+    ShmRingShared *s = r.shared;
+    s->head.store(r.head, std::memory_order_release);
+    r.head_published = r.head;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (s->producer_waiting.load(std::memory_order_relaxed)) {
+        s->producer_waiting.store(0, std::memory_order_relaxed);
+        s->space_seq.fetch_add(1, std::memory_order_release);
+        shm_futex_wake(&s->space_seq);
+    }
+}
+
+// Block until a record is published. Returns false once the ring is closed and drained, or
+// peer_fd is set and the producer has gone away.
+static inline bool shm_ring_wait_data(ShmRing &r) {
+    ShmRingShared *s = r.shared;
+    for (unsigned i = 0;; i++) {
+        r.tail_cache = s->tail.load(std::memory_order_acquire);
+        if (r.tail_cache != r.head) return true;
+        if (i == 0) shm_ring_release(r); // the producer may be waiting for space we hold
+        if (s->closed.load(std::memory_order_acquire)) {
+            r.tail_cache = s->tail.load(std::memory_order_acquire);
+            return r.tail_cache != r.head;
+        }
+        if (i < r.spin) {
+            shm_ring_pause();
+            continue;
+        }
+        uint32_t seq = s->data_seq.load(std::memory_order_acquire);
+        s->consumer_waiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (s->tail.load(std::memory_order_acquire) != r.head || s->closed.load(std::memory_order_acquire)) {
+            s->consumer_waiting.store(0, std::memory_order_relaxed);
+            continue;
+        }
+        if (r.peer_fd < 0) {
+            shm_futex_wait(&s->data_seq, seq);
+            continue;
+        }
+        struct timespec check = {0, SHM_RING_PEER_CHECK_MS * 1000000L};
+        shm_futex_wait(&s->data_seq, seq, &check);
+        if (shm_peer_gone(r.peer_fd)) {
+            r.tail_cache = s->tail.load(std::memory_order_acquire);
+            return r.tail_cache != r.head;
+        }
+    }
+}
+
+// Copy the next message into buf (at most cap bytes) and return the number of bytes copied,
+// or -1 at EOF. A message longer than cap is truncated and the rest of it is dropped; pass
+// msg_len to learn its full length. A record that does not fit in the published part of the
+// ring can only come from a broken or hostile producer, and is treated as EOF.
+static inline long shm_ring_read(ShmRing &r, void *buf, size_t cap, size_t *msg_len = NULL) {
+    for (;;) {
+        if (r.head == r.tail_cache && !shm_ring_wait_data(r)) return -1;
+        uint64_t off = r.head & r.mask;
+        uint64_t avail = r.tail_cache - r.head; // published bytes not consumed yet
+        const char *p = r.data + off;
+        uint32_t len;
+        memcpy(&len, p, 4);
+        if (len == SHM_RING_WRAP) {
+            if (r.capacity - off > avail) return -1;
+            r.head += r.capacity - off;
+            continue;
+        }
+        uint64_t rec = (4 + (uint64_t)len + 7) & ~7ull;
+        if (len > r.capacity - off - 4 || rec > avail) return -1;
+        size_t n = len < cap ? len : cap;
+        memcpy(buf, p + 4, n);
+        r.head += rec;
+        if (r.head - r.head_published >= r.batch) shm_ring_release(r);
+        if (msg_len) *msg_len = len;
+        return (long)n;
+    }
+}
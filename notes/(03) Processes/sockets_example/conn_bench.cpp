@@ -0,0 +1,77 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#define PORT 8080
+#define BUFFER_SIZE 1024
+
+// Connections per second against server.cpp-style servers: every thread repeats the exchange
+// of client.cpp (connect, send "Hello from client", read the reply, close) as fast as it can.
+//
+//   ./conn_bench [threads] [seconds]    (default 8 threads for 5 seconds)
+
+static int seconds = 5;
+static struct sockaddr_in serv_addr;
+
+struct Result {
+    unsigned long long connections, failures;
+};
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void *client_loop(void *arg) {
+    Result *r = (Result *)arg;
+    const char *hello = "Hello from client";
+    char buffer[BUFFER_SIZE];
+    double end = now_sec() + seconds;
+    while (now_sec() < end) {
+        int sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool ok = sock >= 0 && connect(sock, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) == 0 &&
+                  send(sock, hello, strlen(hello), MSG_NOSIGNAL) > 0 && read(sock, buffer, sizeof(buffer)) > 0;
+        if (sock >= 0) close(sock);
+        if (ok) {
+            r->connections++;
+        } else {
+            r->failures++;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int nthreads = (argc > 1) ? atoi(argv[1]) : 8;
+    if (argc > 2) seconds = atoi(argv[2]);
+    if (nthreads < 1 || seconds < 1) {
+        fprintf(stderr, "Usage: %s [threads] [seconds]\n", argv[0]);
+        return 1;
+    }
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(PORT);
+    inet_pton(AF_INET, "127.0.0.1", &serv_addr.sin_addr);
+
+    pthread_t *tids = (pthread_t *)calloc((size_t)nthreads, sizeof(pthread_t));
+    Result *results = (Result *)calloc((size_t)nthreads, sizeof(Result));
+    double start = now_sec();
+    for (int i = 0; i < nthreads; i++) pthread_create(&tids[i], NULL, client_loop, &results[i]);
+
+    unsigned long long connections = 0, failures = 0;
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(tids[i], NULL);
+        connections += results[i].connections;
+        failures += results[i].failures;
+    }
+    double elapsed = now_sec() - start;
+    printf("%llu connections (%llu failed) in %.2f s: %.0f connections/sec\n", connections, failures, elapsed,
+           (double)connections / elapsed);
+    free(tids);
+    free(results);
+    return failures ? 1 : 0;
+}
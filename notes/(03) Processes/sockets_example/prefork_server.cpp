@@ -0,0 +1,451 @@
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h> // POSIX functions
+#include <arpa/inet.h> // IPv4 socket addresses
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define PORT 8080
+#define BUFFER_SIZE 1024
+#define MAX_WORKERS 256
+#define CONTROL_PATH "/tmp/prefork_server.sock" // a new master asks the running one for its listener here
+#define RESPAWN_DELAY_MS 1000 // a worker that dies sooner than this after starting is restarted this late
+#define CLIENT_TIMEOUT_S 5 // a client that sends nothing for this long is dropped
+
+// Pre-forked server: the master binds PORT once and forks one worker process per core. Every
+// worker inherits the same listening socket and waits for connections on it with its own epoll
+// instance. The master itself never accepts; it only starts, restarts and stops workers, and
+// hands the listening socket over to a new master on reload.
+
+// Per-worker counters in shared memory: the workers add to them, the master prints them. They
+// survive a worker restart, because they belong to the slot and not to the process.
+struct WorkerStats {
+    unsigned long long connections; // accepted and answered
+    unsigned long long wakeups; // returns from epoll_wait
+    unsigned long long empty_wakeups; // wakeups where another worker had already taken the connection
+};
+
+struct Slot {
+    pid_t pid; // 0 while the worker is not running
+    long long started_ms;
+    long long respawn_at_ms; // when to start it again after a crash
+    unsigned restarts;
+};
+
+static WorkerStats *stats;
+static Slot slots[MAX_WORKERS];
+static int nworkers, ncpu;
+static bool exclusive = true;
+static int server_fd = -1, control_fd = -1, sig_fd = -1;
+static char self_path[PATH_MAX]; // re-executed on SIGHUP
+static char **self_argv;
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int create_listener(void) {
+    // Non-blocking: a worker woken for a connection another worker already took must not block
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Socket failed");
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY; // Accept connections on any local IP
+    address.sin_port = htons(PORT);
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("Bind failed");
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN) < 0) {
+        perror("Listen failed");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// ---------------------------------------------------------------------------------------
+// Worker
+// ---------------------------------------------------------------------------------------
+
+static volatile sig_atomic_t worker_stop = 0;
+static void on_worker_signal(int) { worker_stop = 1; }
+
+// Same exchange as server.cpp: read the client's message, answer, close
+static void serve_client(int fd) {
+    struct timeval tv = {CLIENT_TIMEOUT_S, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char buffer[BUFFER_SIZE];
+    const char *hello = "Hello from server";
+    if (read(fd, buffer, sizeof(buffer)) > 0) {
+        send(fd, hello, strlen(hello), MSG_NOSIGNAL);
+    }
+    close(fd);
+}
+
+static void worker_main(int id) {
+    close(sig_fd);
+    close(control_fd);
+    WorkerStats *st = &stats[id];
+
+    // One worker per core: pin it there, so the kernel does not move workers around
+    if (nworkers <= ncpu) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(id, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+
+    // The master's signals are still blocked (inherited). They stay blocked while a client is
+    // served, and epoll_pwait() unblocks them only while waiting, so SIGTERM lets the current
+    // client finish and no signal is lost between the check and the wait.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_worker_signal;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+    signal(SIGHUP, SIG_IGN); // reloads are the master's business
+    signal(SIGCHLD, SIG_DFL);
+    sigset_t wait_mask;
+    sigemptyset(&wait_mask);
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {};
+    // EPOLLEXCLUSIVE: a new connection wakes one waiting worker instead of all of them
+    ev.events = EPOLLIN | (exclusive ? (uint32_t)EPOLLEXCLUSIVE : 0u);
+    ev.data.fd = server_fd;
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, server_fd, &ev) < 0) {
+        perror("epoll");
+        exit(EXIT_FAILURE);
+    }
+
+    while (!worker_stop) {
+        struct epoll_event out;
+        if (epoll_pwait(epfd, &out, 1, -1, &wait_mask) <= 0) continue; // EINTR: asked to stop
+        __atomic_add_fetch(&st->wakeups, 1, __ATOMIC_RELAXED);
+
+        int cfd = accept4(server_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (cfd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                __atomic_add_fetch(&st->empty_wakeups, 1, __ATOMIC_RELAXED);
+            }
+            continue;
+        }
+        serve_client(cfd);
+        __atomic_add_fetch(&st->connections, 1, __ATOMIC_RELAXED);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+// ---------------------------------------------------------------------------------------
+// Master
+// ---------------------------------------------------------------------------------------
+
+static void spawn_worker(int id) {
+    fflush(stdout); // the worker must not inherit unwritten output
+    pid_t pid = fork();
+    if (pid == 0) worker_main(id);
+    if (pid < 0) {
+        perror("fork");
+        slots[id].respawn_at_ms = now_ms() + RESPAWN_DELAY_MS;
+        return;
+    }
+    slots[id].pid = pid;
+    slots[id].started_ms = now_ms();
+}
+
+// Reap exited workers and schedule their restart
+static void reap_workers(void) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        for (int i = 0; i < nworkers; i++) {
+            if (slots[i].pid != pid) continue;
+            slots[i].pid = 0;
+            if (WIFSIGNALED(status)) {
+                printf("Worker %d (PID %d) killed by signal %d, restarting\n", i, pid, WTERMSIG(status));
+            } else {
+                printf("Worker %d (PID %d) exited with status %d, restarting\n", i, pid, WEXITSTATUS(status));
+            }
+            // A worker that crashes right after starting would otherwise be restarted in a tight loop
+            slots[i].respawn_at_ms = slots[i].started_ms + RESPAWN_DELAY_MS;
+            slots[i].restarts++;
+            break;
+        }
+    }
+}
+
+// Start every worker whose restart is due; returns the poll() timeout until the next one
+static int respawn_due(void) {
+    long long now = now_ms(), next = -1;
+    for (int i = 0; i < nworkers; i++) {
+        if (slots[i].pid != 0) continue;
+        if (slots[i].respawn_at_ms <= now) {
+            spawn_worker(i);
+        } else if (next < 0 || slots[i].respawn_at_ms < next) {
+            next = slots[i].respawn_at_ms;
+        }
+    }
+    return next < 0 ? -1 : (int)(next - now);
+}
+
+static void stop_workers(void) {
+    for (int i = 0; i < nworkers; i++) {
+        if (slots[i].pid > 0) kill(slots[i].pid, SIGTERM);
+    }
+    for (int i = 0; i < nworkers; i++) {
+        if (slots[i].pid > 0) waitpid(slots[i].pid, NULL, 0);
+        slots[i].pid = 0;
+    }
+}
+
+static void control_address(struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, CONTROL_PATH);
+}
+
+// Send fd over a Unix socket as SCM_RIGHTS ancillary data, with one byte of ordinary data
+static int send_fd(int sock, int fd) {
+    char byte = 'L';
+    struct iovec iov = {&byte, 1};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } u;
+    memset(&u, 0, sizeof(u));
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof(u.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    return sendmsg(sock, &msg, MSG_NOSIGNAL) == 1 ? 0 : -1;
+}
+
+static int recv_fd(int sock) {
+    char byte;
+    struct iovec iov = {&byte, 1};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } u;
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof(u.buf);
+    if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1) return -1;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) return -1;
+    int fd;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+    return fd;
+}
+
+// Reload, new master's side: if a master is already running, ask it for its listening socket.
+// Returns the socket, with *conn left open for the "ready" reply, or -1 if there is no master.
+static int take_over(int *conn) {
+    struct sockaddr_un addr;
+    control_address(&addr);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    int lfd = recv_fd(fd);
+    if (lfd < 0) {
+        close(fd);
+        return -1;
+    }
+    struct ucred peer;
+    socklen_t len = sizeof(peer);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &len) == 0) {
+        printf("Took over the listening socket from master PID %d\n", peer.pid);
+    }
+    *conn = fd;
+    return lfd;
+}
+
+// Reload, old master's side: a new master connected to the control socket. Hand it the
+// listening socket and wait until its workers are running. Returns true if the new master
+// took over, and this one should drain its workers and exit.
+static bool hand_over(void) {
+    int conn = accept4(control_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (conn < 0) return false;
+
+    bool done = false;
+    if (send_fd(conn, server_fd) == 0) {
+        struct pollfd p = {conn, POLLIN, 0};
+        char ready;
+        done = poll(&p, 1, 10000) == 1 && read(conn, &ready, 1) == 1;
+    }
+    struct ucred peer;
+    socklen_t len = sizeof(peer);
+    getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &peer, &len);
+    if (done) {
+        printf("Handed the listening socket to master PID %d, draining workers\n", peer.pid);
+    } else {
+        printf("New master PID %d failed to start, still serving\n", peer.pid);
+    }
+    close(conn);
+    return done;
+}
+
+static int listen_control(void) {
+    struct sockaddr_un addr;
+    control_address(&addr);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(CONTROL_PATH); // left behind by a master that was killed, or the one we took over from
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// SIGHUP: start a fresh copy of this program (possibly a newly built one), which takes over
+// through the control socket
+static void start_replacement(void) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(self_path, self_argv);
+        perror(self_path);
+        _exit(127);
+    }
+    if (pid < 0) perror("fork");
+}
+
+int main(int argc, char **argv) {
+    ncpu = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    nworkers = ncpu;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+            nworkers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-exclusive") == 0) {
+            exclusive = false;
+        } else {
+            nworkers = -1;
+        }
+    }
+    if (nworkers < 1 || nworkers > MAX_WORKERS) {
+        fprintf(stderr, "Usage: %s [-w N_workers] [--no-exclusive]  (N = 1..%d, default one per CPU)\n", argv[0],
+                MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+    if (!realpath(argv[0], self_path)) strcpy(self_path, "/proc/self/exe");
+    self_argv = argv;
+
+    // The master handles its signals synchronously through a signalfd
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGHUP);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+    sig_fd = signalfd(-1, &mask, SFD_CLOEXEC);
+    signal(SIGPIPE, SIG_IGN);
+
+    stats = (WorkerStats *)mmap(NULL, sizeof(WorkerStats) * MAX_WORKERS, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (sig_fd < 0 || stats == MAP_FAILED) {
+        perror("setup");
+        exit(EXIT_FAILURE);
+    }
+
+    // Reuse the running master's socket if there is one, so no connection is refused meanwhile
+    int old_master = -1;
+    server_fd = take_over(&old_master);
+    if (server_fd < 0) server_fd = create_listener();
+    if (server_fd < 0) exit(EXIT_FAILURE);
+
+    for (int i = 0; i < nworkers; i++) spawn_worker(i);
+    printf("Server listening on port %d (master PID %d, %d workers, %s)\n", PORT, getpid(), nworkers,
+           exclusive ? "EPOLLEXCLUSIVE" : "every worker woken");
+    fflush(stdout);
+
+    // Our workers are accepting: the old master can stop its own
+    if (old_master >= 0) {
+        char ready = 'R';
+        if (write(old_master, &ready, 1) != 1) perror("reload");
+        close(old_master);
+    }
+    control_fd = listen_control();
+    if (control_fd < 0) perror(CONTROL_PATH); // still serves, but cannot be reloaded
+
+    bool stopping = false, handed_over = false;
+    int timeout = -1;
+    while (!stopping) {
+        struct pollfd pfd[2] = {{sig_fd, POLLIN, 0}, {control_fd, POLLIN, 0}};
+        int n = poll(pfd, control_fd >= 0 ? 2 : 1, timeout);
+        if (n < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+
+        // One signal per read; any others are still pending at the next poll()
+        struct signalfd_siginfo si;
+        if ((pfd[0].revents & POLLIN) && read(sig_fd, &si, sizeof(si)) == sizeof(si)) {
+            if (si.ssi_signo == SIGCHLD) reap_workers(); // also reaps a replacement master that failed
+            if (si.ssi_signo == SIGINT || si.ssi_signo == SIGTERM) stopping = true;
+            if (si.ssi_signo == SIGHUP) start_replacement();
+        }
+        if (control_fd >= 0 && (pfd[1].revents & POLLIN) && hand_over()) {
+            stopping = handed_over = true;
+        }
+        timeout = stopping ? -1 : respawn_due();
+        fflush(stdout);
+    }
+
+    stop_workers();
+    close(server_fd);
+    if (control_fd >= 0) close(control_fd);
+    if (!handed_over) unlink(CONTROL_PATH); // after a hand-over it belongs to the new master
+
+    unsigned long long total = 0;
+    for (int i = 0; i < nworkers; i++) {
+        const WorkerStats &s = stats[i];
+        printf("worker %d: %llu connections, %llu wakeups (%llu found nothing to accept), %u restarts\n", i,
+               s.connections, s.wakeups, s.empty_wakeups, slots[i].restarts);
+        total += s.connections;
+    }
+    // A wake-up that finds nothing is mostly hidden in the kernel: epoll_wait() re-checks the
+    // listener and goes back to sleep. The context switches of the workers show it.
+    struct rusage ru;
+    getrusage(RUSAGE_CHILDREN, &ru);
+    long switches = ru.ru_nvcsw + ru.ru_nivcsw;
+    printf("%llu connections served by PID %d, %.2f worker context switches per connection\n", total, getpid(),
+           total ? (double)switches / (double)total : 0.0);
+    return 0;
+}
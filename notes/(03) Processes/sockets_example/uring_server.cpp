@@ -0,0 +1,513 @@
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h> // POSIX functions
+#include <arpa/inet.h> // IPv4 socket addresses
+#include <linux/io_uring.h> // io_uring structures (no liburing needed)
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#define PORT 8080
+#define QUEUE_DEPTH 1024 // submission queue entries
+#define BUF_COUNT 4096 // provided receive buffers (power of two)
+#define BUF_SIZE 2048 // bytes per provided buffer
+#define BUF_GROUP 1 // buffer group id the multishot recvs select from
+
+// What a completion belongs to, packed into the 64-bit user_data of each request:
+// bits 56..63 = event type, bits 48..55 = connection generation, bits 32..47 = buffer id,
+// bits 0..31 = file descriptor
+enum { EV_ACCEPT = 1, EV_RECV = 2, EV_SEND = 3, EV_CLOSE = 4 };
+
+static uint64_t pack(int type, int fd, int bid, uint8_t gen = 0) {
+    return ((uint64_t)type << 56) | ((uint64_t)gen << 48) | ((uint64_t)(uint16_t)bid << 32) | (uint32_t)fd;
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+static void on_signal(int) { stop_requested = 1; }
+
+// Counters printed on exit: the point of this example is syscalls per echoed message
+static unsigned long long messages = 0, bytes = 0, syscalls = 0, accepted = 0;
+
+static int create_listener(void) {
+    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server_fd < 0) {
+        perror("Socket failed");
+        return -1;
+    }
+
+    int opt = 1;
+    setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY; // Accept connections on any local IP
+    address.sin_port = htons(PORT);
+
+    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        perror("Bind failed");
+        close(server_fd);
+        return -1;
+    }
+    if (listen(server_fd, SOMAXCONN) < 0) {
+        perror("Listen failed");
+        close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+// ---------------------------------------------------------------------------------------
+// io_uring backend
+// ---------------------------------------------------------------------------------------
+
+// The two shared rings plus the SQE array, mapped from the kernel
+struct Ring {
+    int fd = -1;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned sq_local_tail = 0; // SQEs filled in but not yet published to the kernel
+    unsigned to_submit = 0;
+};
+
+// Provided buffer ring: the kernel picks a free buffer for each recv, we hand it back after
+// the echo has been sent
+struct BufRing {
+    // The ring is an array of io_uring_buf whose first entry's resv field doubles as the tail.
+    // We index it ourselves: in C++ some kernel headers lay out io_uring_buf_ring::bufs at
+    // offset 8 instead of 0, which silently hands the kernel an empty ring (ENOBUFS).
+    struct io_uring_buf *br = NULL;
+    uint16_t *br_tail = NULL;
+    char *base = NULL;
+    unsigned tail = 0; // published tail
+    unsigned pending = 0; // buffers returned since the last publish
+};
+
+// A received chunk waiting to be echoed back
+struct PendingSend {
+    int bid;
+    unsigned off;
+    unsigned len;
+};
+
+// Only one send per socket is in flight at a time, so echoed data keeps its order
+struct UringConn {
+    uint8_t gen = 0; // bumped on close: completions of an earlier connection on this fd are stale
+    bool open = false;
+    bool sending = false;
+    bool closing = false; // peer hung up: close once queued echoes are written
+    std::deque<PendingSend> queue;
+};
+
+static Ring ring;
+static BufRing bufs;
+// A socket whose multishot recv stopped for lack of buffers. The generation tells a re-arm
+// for this connection apart from one for a later connection that reused the fd.
+struct StarvedRecv {
+    int fd;
+    uint8_t gen;
+};
+
+static std::vector<UringConn> uconns;
+static std::vector<StarvedRecv> starved;
+
+static int ring_setup(unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    // Multishot requests produce many completions per submission, so size the CQ generously.
+    // COOP_TASKRUN avoids interrupting us with completion work while we are busy.
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+    p.cq_entries = entries * 8;
+    int fd = (int)syscall(SYS_io_uring_setup, entries, &p);
+    if (fd < 0 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p)); // older kernel: retry without the optional flags
+        fd = (int)syscall(SYS_io_uring_setup, entries, &p);
+    }
+    if (fd < 0) return -1;
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size) sq_size = cq_size;
+        cq_size = sq_size;
+    }
+
+    char *sq = (char *)mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) return -1;
+    char *cq = sq;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        cq = (char *)mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) return -1;
+    }
+    ring.sqes = (struct io_uring_sqe *)mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+                                            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring.sqes == MAP_FAILED) return -1;
+
+    ring.fd = fd;
+    ring.sq_head = (unsigned *)(sq + p.sq_off.head);
+    ring.sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    ring.sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    ring.sq_array = (unsigned *)(sq + p.sq_off.array);
+    ring.sq_entries = p.sq_entries;
+    ring.cq_head = (unsigned *)(cq + p.cq_off.head);
+    ring.cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    ring.cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    ring.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    ring.sq_local_tail = *ring.sq_tail;
+    return 0;
+}
+
+// Publish queued SQEs and (optionally) wait for completions: one syscall for both
+static int ring_enter(unsigned wait_nr) {
+    __atomic_store_n(ring.sq_tail, ring.sq_local_tail, __ATOMIC_RELEASE);
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    syscalls++;
+    int rc = (int)syscall(SYS_io_uring_enter, ring.fd, ring.to_submit, wait_nr, flags, NULL, 0);
+    if (rc >= 0) ring.to_submit -= (unsigned)rc < ring.to_submit ? (unsigned)rc : ring.to_submit;
+    return rc;
+}
+
+static struct io_uring_sqe *get_sqe(void) {
+    // SQ full: push what we have to the kernel first (rare with QUEUE_DEPTH entries)
+    while (ring.sq_local_tail - __atomic_load_n(ring.sq_head, __ATOMIC_ACQUIRE) >= ring.sq_entries) {
+        if (ring_enter(0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) return NULL;
+    }
+    unsigned idx = ring.sq_local_tail & *ring.sq_mask;
+    struct io_uring_sqe *sqe = &ring.sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    ring.sq_array[idx] = idx;
+    ring.sq_local_tail++;
+    ring.to_submit++;
+    return sqe;
+}
+
+static int setup_buffer_ring(void) {
+    size_t ring_bytes = BUF_COUNT * sizeof(struct io_uring_buf);
+    bufs.br = (struct io_uring_buf *)mmap(NULL, ring_bytes, PROT_READ | PROT_WRITE,
+                                          MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    bufs.base = (char *)mmap(NULL, (size_t)BUF_COUNT * BUF_SIZE, PROT_READ | PROT_WRITE,
+                             MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (bufs.br == MAP_FAILED || bufs.base == MAP_FAILED) return -1;
+    bufs.br_tail = &bufs.br[0].resv;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)bufs.br;
+    reg.ring_entries = BUF_COUNT;
+    reg.bgid = BUF_GROUP;
+    syscalls++;
+    if (syscall(SYS_io_uring_register, ring.fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return -1;
+
+    for (int bid = 0; bid < BUF_COUNT; bid++) {
+        struct io_uring_buf *b = &bufs.br[bid];
+        b->addr = (uint64_t)(uintptr_t)(bufs.base + (size_t)bid * BUF_SIZE);
+        b->len = BUF_SIZE;
+        b->bid = (uint16_t)bid;
+    }
+    bufs.tail = BUF_COUNT;
+    __atomic_store_n(bufs.br_tail, (uint16_t)bufs.tail, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Give a buffer back to the kernel; made visible in batches by publish_buffers()
+static void recycle_buffer(int bid) {
+    struct io_uring_buf *b = &bufs.br[(bufs.tail + bufs.pending) & (BUF_COUNT - 1)];
+    b->addr = (uint64_t)(uintptr_t)(bufs.base + (size_t)bid * BUF_SIZE);
+    b->len = BUF_SIZE;
+    b->bid = (uint16_t)bid;
+    bufs.pending++;
+}
+
+static void arm_accept(int server_fd) {
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = server_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT; // one SQE keeps accepting until it is cancelled
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = pack(EV_ACCEPT, server_fd, 0);
+}
+
+static void arm_recv(int fd) {
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT; // one SQE, one CQE per arriving chunk
+    sqe->flags = IOSQE_BUFFER_SELECT; // the kernel picks a buffer from BUF_GROUP
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = pack(EV_RECV, fd, 0, uconns[fd].gen);
+}
+
+static void publish_buffers(void) {
+    if (bufs.pending == 0) return;
+    bufs.tail += bufs.pending;
+    bufs.pending = 0;
+    __atomic_store_n(bufs.br_tail, (uint16_t)bufs.tail, __ATOMIC_RELEASE);
+
+    // Buffers are back: restart receives that ran dry
+    for (const StarvedRecv &s : starved) {
+        const UringConn &c = uconns[s.fd];
+        if (c.open && !c.closing && c.gen == s.gen) arm_recv(s.fd);
+    }
+    starved.clear();
+}
+
+static void submit_send(int fd) {
+    UringConn &c = uconns[fd];
+    const PendingSend &p = c.queue.front();
+    struct io_uring_sqe *sqe = get_sqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)(bufs.base + (size_t)p.bid * BUF_SIZE + p.off);
+    sqe->len = p.len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = pack(EV_SEND, fd, p.bid, c.gen);
+    c.sending = true;
+}
+
+static void close_conn(int fd) {
+    UringConn &c = uconns[fd];
+    for (const PendingSend &p : c.queue) recycle_buffer(p.bid);
+    uint8_t gen = c.gen;
+    c = UringConn();
+    c.gen = (uint8_t)(gen + 1);
+    struct io_uring_sqe *sqe = get_sqe(); // closing through the ring saves a syscall too
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+    sqe->user_data = pack(EV_CLOSE, fd, 0);
+}
+
+static void handle_cqe(const struct io_uring_cqe *cqe, int server_fd) {
+    int type = (int)(cqe->user_data >> 56);
+    int fd = (int)(uint32_t)cqe->user_data;
+    uint8_t gen = (uint8_t)(cqe->user_data >> 48);
+    bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+
+    switch (type) {
+    case EV_ACCEPT:
+        if (cqe->res >= 0) {
+            int cfd = cqe->res;
+            if ((size_t)cfd >= uconns.size()) uconns.resize((size_t)cfd * 2 + 1);
+            uint8_t gen = uconns[cfd].gen;
+            uconns[cfd] = UringConn();
+            uconns[cfd].gen = gen;
+            uconns[cfd].open = true;
+            accepted++;
+            arm_recv(cfd);
+        } else if (cqe->res != -EINTR && cqe->res != -ECANCELED) {
+            fprintf(stderr, "accept: %s\n", strerror(-cqe->res));
+        }
+        if (!more && !stop_requested) arm_accept(server_fd); // multishot ended: re-arm
+        break;
+
+    case EV_RECV: {
+        UringConn &c = uconns[fd];
+        if (!c.open || c.gen != gen) {
+            // The connection was closed (and the fd maybe reused) while this recv was armed:
+            // drop the data, but hand its buffer back or the buffer ring runs dry
+            if (cqe->res > 0) recycle_buffer((int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+            break;
+        }
+        if (cqe->res > 0) {
+            int bid = (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+            messages++;
+            bytes += (unsigned long long)cqe->res;
+            c.queue.push_back(PendingSend{bid, 0, (unsigned)cqe->res});
+            if (!c.sending) submit_send(fd);
+            if (!more) arm_recv(fd); // kernel stopped the multishot (e.g. CQ overflow)
+        } else if (cqe->res == -ENOBUFS) {
+            starved.push_back(StarvedRecv{fd, gen}); // re-armed once sends hand buffers back
+        } else {
+            // EOF or error: finish echoing what we already have, then close
+            c.closing = true;
+            if (!c.sending) close_conn(fd);
+        }
+        break;
+    }
+
+    case EV_SEND: {
+        UringConn &c = uconns[fd];
+        int bid = (int)((cqe->user_data >> 32) & 0xFFFF);
+        if (!c.open || c.gen != gen || c.queue.empty()) break;
+        PendingSend &p = c.queue.front();
+        if (cqe->res < 0) {
+            close_conn(fd); // peer went away; close_conn() recycles queued buffers
+            break;
+        }
+        if ((unsigned)cqe->res < p.len) {
+            p.off += (unsigned)cqe->res; // short send: push out the rest
+            p.len -= (unsigned)cqe->res;
+            submit_send(fd);
+            break;
+        }
+        c.queue.pop_front();
+        recycle_buffer(bid);
+        c.sending = false;
+        if (!c.queue.empty()) {
+            submit_send(fd);
+        } else if (c.closing) {
+            close_conn(fd);
+        }
+        break;
+    }
+
+    case EV_CLOSE:
+        break;
+    }
+}
+
+static int run_uring(int server_fd) {
+    if (ring_setup(QUEUE_DEPTH) < 0) {
+        perror("io_uring_setup");
+        return -1;
+    }
+    if (setup_buffer_ring() < 0) {
+        perror("io_uring_register(PBUF_RING)");
+        close(ring.fd);
+        return -1;
+    }
+    uconns.resize(1024);
+
+    printf("Server listening on port %d (io_uring)...\n", PORT);
+    fflush(stdout);
+
+    arm_accept(server_fd);
+    while (!stop_requested) {
+        // Submit everything queued by the previous batch and sleep until something completes
+        if (ring_enter(1) < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            perror("io_uring_enter");
+            break;
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            handle_cqe(&ring.cqes[head & *ring.cq_mask], server_fd);
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+        publish_buffers();
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------
+// epoll fallback (kernels without io_uring, or io_uring disabled by policy)
+// ---------------------------------------------------------------------------------------
+
+static int run_epoll(int server_fd) {
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return -1;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = server_fd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, server_fd, &ev);
+    syscalls += 2;
+
+    std::vector<std::string> pending(1024); // unsent echo bytes per socket
+    char buffer[BUF_SIZE];
+
+    printf("Server listening on port %d (epoll)...\n", PORT);
+    fflush(stdout);
+
+    struct epoll_event events[256];
+    while (!stop_requested) {
+        syscalls++;
+        int n = epoll_wait(epfd, events, 256, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == server_fd) {
+                syscalls++;
+                int cfd = accept4(server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (cfd < 0) continue;
+                if ((size_t)cfd >= pending.size()) pending.resize((size_t)cfd * 2 + 1);
+                pending[cfd].clear();
+                struct epoll_event cev = {};
+                cev.events = EPOLLIN;
+                cev.data.fd = cfd;
+                syscalls++;
+                epoll_ctl(epfd, EPOLL_CTL_ADD, cfd, &cev);
+                accepted++;
+                continue;
+            }
+
+            bool dead = false;
+            if (events[i].events & EPOLLOUT) {
+                syscalls++;
+                ssize_t w = send(fd, pending[fd].data(), pending[fd].size(), MSG_NOSIGNAL);
+                if (w < 0 && errno != EAGAIN) dead = true;
+                if (w > 0) pending[fd].erase(0, (size_t)w);
+            }
+            if (!dead && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && pending[fd].empty()) {
+                syscalls++;
+                ssize_t r = read(fd, buffer, sizeof(buffer));
+                if (r <= 0) {
+                    dead = r == 0 || errno != EAGAIN;
+                } else {
+                    messages++;
+                    bytes += (unsigned long long)r;
+                    syscalls++;
+                    ssize_t w = send(fd, buffer, (size_t)r, MSG_NOSIGNAL);
+                    if (w < 0 && errno != EAGAIN) dead = true;
+                    if (!dead && w < r) pending[fd].assign(buffer + (w > 0 ? w : 0), (size_t)(r - (w > 0 ? w : 0)));
+                }
+            }
+            if (dead) {
+                syscalls++;
+                close(fd);
+                pending[fd].clear();
+                continue;
+            }
+            // Watch for writability only while an echo is backed up
+            struct epoll_event cev = {};
+            cev.events = pending[fd].empty() ? EPOLLIN : EPOLLOUT;
+            cev.data.fd = fd;
+            if ((events[i].events & EPOLLOUT) != (cev.events & EPOLLOUT)) {
+                syscalls++;
+                epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &cev);
+            }
+        }
+    }
+    close(epfd);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    bool force_epoll = argc > 1 && strcmp(argv[1], "--epoll") == 0;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_signal; // no SA_RESTART: the blocking wait returns EINTR on Ctrl+C
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int server_fd = create_listener();
+    if (server_fd < 0) exit(EXIT_FAILURE);
+
+    if (force_epoll || run_uring(server_fd) < 0) {
+        if (!force_epoll) printf("io_uring unavailable, falling back to epoll\n");
+        if (run_epoll(server_fd) < 0) exit(EXIT_FAILURE);
+    }
+
+    printf("\n%llu connections, %llu messages, %llu bytes echoed\n", accepted, messages, bytes);
+    printf("%llu syscalls (%.2f per message)\n", syscalls, messages ? (double)syscalls / (double)messages : 0.0);
+    close(server_fd);
+    return 0;
+}